@@ -3,8 +3,13 @@
         { "target_name": "word_vec",
           "sources": ["word_vec.cpp",
                       "cpp/compressor/compressor.cpp",
+                      "cpp/encoder/encoder.cpp",
+                      "cpp/writer/writer.cpp",
+                      "cpp/container/container.cpp",
                       "cpp/parser/parser.cpp",
                       "cpp/semantics/semantics.cpp",
+                      "cpp/wordnet/wordnet.cpp",
+                      "cpp/symbols/symbols.cpp",
                       "cpp/tagger/crf.cpp",
                       "cpp/tagger/crfpos.cpp",
                       "cpp/tagger/la_pos.cpp",
@@ -12,11 +17,12 @@
                       "cpp/tagger/tokenize.cpp" ],
          "include_dirs": ["/usr/local/include", 
                           "/usr/include"],
-         "libraries": ["-lboost_serialization", "-L/usr/local/lib",
-                       "-lwordnet", "-L/usr/lib",
-                       "-lsmnet", "-L/usr/local/lib"],
+         "libraries": ["-lboost_serialization", "-L/usr/local/lib"],
          "cflags_cc": ["-std=c++11", "-fexceptions"],
          "cflags_cc!": ["-fno-rtti"],
+         "configurations": {
+             "Release": {"defines": ["NDEBUG"]}
+         }
         }
     ]
 }
@@ -0,0 +1,127 @@
+// Reads a `wvc` vector container (see cpp/container/container.hpp) written by
+// `compress_to_file(..., 'wvc')`: the addon maps the file and validates its
+// header, then sections are viewed by range as typed arrays over the mapping,
+// so a container is never copied (or has to fit in a single Buffer) at once.
+var wv = require('./build/Release/word_vec.node');
+
+// @return the number of the float16 bits `bits`
+function half(bits)
+{
+    var exponent = (bits >> 10) & 0x1f, mantissa = bits & 0x3ff;
+    var value = exponent === 0  ? mantissa * Math.pow(2, -24)
+              : exponent === 31 ? (mantissa ? NaN : Infinity)
+              : (1 + mantissa / 1024) * Math.pow(2, exponent - 15);
+    return bits & 0x8000 ? -value : value;
+}
+
+// an open container: {rows, width, columns, encodable, non_encodable,
+// vocabulary, dtype, csr} and, for csr containers, {nnz}; call `close` when done
+function Container(filename)
+{
+    this.mapped = new wv.Container(filename);
+    var self = this;
+    ['rows', 'width', 'columns', 'encodable', 'non_encodable', 'vocabulary', 'dtype', 'csr']
+        .forEach(function (key) { self[key] = self.mapped[key]; });
+    if (this.csr)
+        this.nnz = this.mapped.nnz;
+}
+
+// @return the scores of reviews `begin` to `end` (exclusive) as a Float32Array
+Container.prototype.scores = function (begin, end)
+{
+    this.check(begin, end);
+    return this.mapped.section('scores', begin, end);
+};
+
+// @return reviews `begin` to `end` (exclusive): {values} holding `width` values
+// per review (dense), or {indptr, indices, values} (csr) where review
+// `begin + i` spans `indptr[i]` to `indptr[i + 1]` of `indices` and `values`.
+// `indices` and `values` are views of the mapped file
+Container.prototype.read = function (begin, end)
+{
+    this.check(begin, end);
+    if (!this.csr)
+        return {values: this.mapped.section('values', begin * this.width, end * this.width)};
+
+    // uint64 offsets as numbers (exact below 2^53), relative to the first review
+    var words = this.mapped.section('indptr', 2 * begin, 2 * (end + 1));
+    var indptr = new Float64Array(end - begin + 1);
+    for (var i = 0; i < indptr.length; i++)
+        indptr[i] = words[2 * i + 1] * 4294967296 + words[2 * i];
+    var first = indptr[0];
+    for (i = 0; i < indptr.length; i++)
+        indptr[i] -= first;
+    return {
+        indptr: indptr,
+        indices: this.mapped.section('indices', first, first + indptr[end - begin]),
+        values: this.mapped.section('values', first, first + indptr[end - begin])
+    };
+};
+
+Container.prototype.check = function (begin, end)
+{
+    if (!this.mapped)
+        throw new Error('container is closed');
+    if (!(begin >= 0 && begin <= end && end <= this.rows))
+        throw new Error('rows out of range: '+begin+' to '+end);
+};
+
+// the file is unmapped once the container and every view read from it are collected
+Container.prototype.close = function ()
+{
+    this.mapped = null;
+};
+
+// @return the container `filename`, mapped for reading by range
+function open(filename)
+{
+    return new Container(filename);
+}
+
+// @return the whole container `filename`: {rows, width, columns, encodable,
+//          non_encodable, vocabulary, scores, dtype, values} and, for csr
+//          containers, {nnz, indptr, indices} - the arrays view the mapped file
+function load(filename)
+{
+    var container = open(filename);
+    try
+    {
+        var result = {
+            rows: container.rows,
+            width: container.width,
+            columns: container.columns,
+            encodable: container.encodable,
+            non_encodable: container.non_encodable,
+            vocabulary: container.vocabulary,
+            scores: container.scores(0, container.rows),
+            dtype: container.dtype
+        };
+        var reviews = container.read(0, container.rows);
+        if (container.csr)
+        {
+            result.nnz = container.nnz;
+            result.indptr = reviews.indptr;
+            result.indices = reviews.indices;
+        }
+        result.values = reviews.values;
+        return result;
+    }
+    finally
+    {
+        container.close();
+    }
+}
+
+// @return value `index` of `container.values` as a number, whatever its dtype
+function value(container, index)
+{
+    var stored = container.values[index];
+    switch (container.dtype)
+    {
+        case 'float16': return half(stored);
+        case 'uint8': return stored / 255;
+        default: return stored;
+    }
+}
+
+module.exports = {open: open, load: load, value: value, half: half};
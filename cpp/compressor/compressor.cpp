@@ -1,116 +1,354 @@
 #include "compressor.hpp"
 
-thrust::host_vector<float> compressor::compress_sparse(const data & arg, const unsigned int columns)
+thrust::host_vector<float> compressor::compress_sparse(const data & arg, const column_layout & columns)
+{
+    return compress(arg.words, columns, true);
+}
+
+/// compress a dense vector from @param arg
+thrust::host_vector<float> compressor::compress_dense(const data & arg, const column_layout & columns)
+{
+    return compress(arg.words, columns, false);
+}
+
+thrust::host_vector<float> compressor::compress(word_range arg, const column_layout & columns, bool sparse)
 {
     unsigned int keys = enc_keys.size() + non_enc_keys.size();
-    thrust::host_vector<float> VR(keys*columns);
+    thrust::host_vector<float> VR(keys*columns.columns);
+    // columns already written, and a scratch row for those merging several positions
+    std::vector<char> written(columns.columns, 0);
+    thrust::host_vector<float> row;
     unsigned int i = 0;
-    const std::vector<word> words = arg.words;
 
-    for (const word & key : words)
+    // each word's row at its column
+    for (const word & key : arg)
     {
-        auto encodable = enc_keys.find(key);
-        auto non_encodable = non_enc_keys.find(key);
+        int column = columns.column(i++);
+        if (column < 0)
+            continue;
 
-        // encodable: add at the begining of position `i`
-        if (encodable != enc_keys.end() && 
-            non_encodable == non_enc_keys.end())
+        auto begin = VR.begin() + (column*keys);
+        if (!written[column])
+            written[column] = encode(key, sparse, begin);
+
+        else
         {
-            thrust::host_vector<float> VC = best_delta_vector(key);
-            thrust::copy(VC.begin(), VC.end(), VR.begin() + (i*keys));
+            row.assign(keys, 0.f);
+            if (encode(key, sparse, row.begin()))
+                for (unsigned int k = 0; k < keys; k++)
+                    *(begin + k) = std::max(*(begin + k), row[k]);
         }
-        // non-encodable: add after the `enc_keys` at position `i`
-        else if (encodable == enc_keys.end() && 
-                 non_encodable != non_enc_keys.end())
+    }
+    return VR;
+}
+
+thrust::host_vector<float> compressor::compress_pooled(const data & arg, bool sparse, pooling mode)
+{
+    return pool(arg.words, sparse, mode);
+}
+
+thrust::host_vector<float> compressor::pool(word_range arg, bool sparse, pooling mode)
+{
+    unsigned int keys = enc_keys.size() + non_enc_keys.size();
+    thrust::host_vector<float> VR(keys);
+    thrust::host_vector<float> row(keys);
+
+    // fold @param weight times the current row into `VR`, then clear it
+    auto fold = [&](float weight)
+    {
+        for (unsigned int k = 0; k < keys; k++)
         {
-            thrust::host_vector<float> VU = binary_vector(key);
-            thrust::copy(VU.begin(), VU.end(), VR.begin() + (i*keys)+enc_keys.size());
+            if (mode == pooling::max)
+                VR[k] = std::max(VR[k], row[k]);
+            else
+                VR[k] += weight * row[k];
+            row[k] = 0.f;
         }
-        else if (encodable != enc_keys.end() && 
-                 non_encodable != non_enc_keys.end())
+    };
+
+    if (mode == pooling::tf)
+    {
+        // distinct words, in order of appearance, and their counts
+        std::unordered_map<word, unsigned int> counts;
+        std::vector<const word*> distinct;
+        for (const word & key : arg)
+            if (counts[key]++ == 0)
+                distinct.push_back(&key);
+
+        float total = 0.f;
+        for (const word * key : distinct)
         {
-            throw std::runtime_error(
-                "key `"+key.token+"`/`"+key.tag+"exists in both principal sets\r\n");
+            float weight = 1.f + std::log(float(counts[*key]));
+            if (encode(*key, sparse, row.begin()))
+                fold(weight);
+            total += weight;
         }
-        i++;
+        if (total > 0.f)
+            for (float & value : VR)
+                value /= total;
+    }
+    else
+    {
+        for (const word & key : arg)
+            if (encode(key, sparse, row.begin()))
+                fold(1.f);
+
+        if (mode == pooling::mean && !arg.empty())
+            for (float & value : VR)
+                value /= arg.size();
     }
     return VR;
 }
 
-/// compress a dense vector from @param arg
-thrust::host_vector<float> compressor::compress_dense(const data & arg, const unsigned int columns)
+void compressor::pooled_data(
+                               std::vector<data> & dataset,
+                               bool sparse,
+                               pooling mode,
+                               unsigned int threads
+                            )
 {
-    unsigned int keys = enc_keys.size() + non_enc_keys.size();
-    thrust::host_vector<float> VR(keys*columns);
-    unsigned int i = 0;
-    const std::vector<word> words = arg.words;
+    // dense rows are shared by all reviews
+    if (!sparse)
+        prepare_dense(threads);
 
-    for (const word & key : words)
+    parallel_for(dataset.size(), threads, [&](std::size_t i)
     {
-        auto encodable = enc_keys.find(key);
-        auto non_encodable = non_enc_keys.find(key);
+        dataset[i].vector = compress_pooled(dataset[i], sparse, mode);
+    });
+}
 
-        // encodable: add at the begining of position `i`
-        if (encodable != enc_keys.end() && 
-            non_encodable == non_enc_keys.end())
+thrust::host_vector<float> compressor::row(const word & key, bool sparse)
+{
+    thrust::host_vector<float> VR(enc_keys.size() + non_enc_keys.size());
+    encode(key, sparse, VR.begin());
+    return VR;
+}
+
+bool compressor::encode(const word & key, bool sparse, thrust::host_vector<float>::iterator row)
+{
+    int encodable = enc_keys.find(key);
+    int non_encodable = non_enc_keys.find(key);
+
+    if (encodable >= 0 && non_encodable >= 0)
+    {
+        throw std::runtime_error(
+            "key `"+key.token()+"`/`"+key.tag()+"exists in both principal sets\r\n");
+    }
+    // encodable & sparse: best delta only
+    else if (encodable >= 0 && sparse)
+    {
+        unsigned int best = 0;
+        float delta = best_match(key, best);
+        if (delta > 0.f)
+            *(row + best) = delta;
+        return delta > 0.f;
+    }
+    // encodable & dense: deltas to all encodable keys
+    else if (encodable >= 0)
+    {
+        if (!enc_rows.empty())
+            thrust::copy(enc_rows[encodable].begin(), enc_rows[encodable].end(), row);
+        else
         {
             thrust::host_vector<float> VC = all_delta_vector(key);
-            thrust::copy(VC.begin(), VC.end(), VR.begin() + (i*keys));
-        }
-        // non-encodable: add after the `enc_keys` at position `i`
-        else if (encodable == enc_keys.end() && 
-                 non_encodable != non_enc_keys.end())
-        {
-            thrust::host_vector<float> VU = binary_vector(key);
-            thrust::copy(VU.begin(), VU.end(), VR.begin() + (i*keys)+enc_keys.size());
+            thrust::copy(VC.begin(), VC.end(), row);
         }
-        else if (encodable != enc_keys.end() && 
-                 non_encodable != non_enc_keys.end())
-        {
-            throw std::runtime_error(
-                "key `"+key.token+"`/`"+key.tag+"exists in both principal sets\r\n");
-        }
-        i++;
+        return true;
     }
-    return VR;
+    // non-encodable: one-hot after the `enc_keys`
+    else if (non_encodable >= 0)
+    {
+        *(row + enc_keys.size() + non_encodable) = 1.f;
+        return true;
+    }
+    return false;
+}
+
+void compressor::prepare_dense(unsigned int threads)
+{
+    if (!enc_rows.empty())
+        return;
+
+    std::vector<thrust::host_vector<float>> rows(enc_keys.size());
+    parallel_for(rows.size(), threads, [&](std::size_t i)
+    {
+        rows[i] = all_delta_vector(enc_keys.words[i]);
+    });
+    enc_rows = std::move(rows);
 }
 
 void compressor::compressed_data(
                                    std::vector<data> & dataset, 
-                                   const unsigned int columns,
-                                   bool sparse
+                                   const column_layout & columns,
+                                   bool sparse,
+                                   unsigned int threads
                                 )
 {
+    // dense rows are shared by all reviews
+    if (!sparse)
+        prepare_dense(threads);
+
     // iterate each review - the `data.vector` is a thrust::host_vector<float>
-    for (data & review : dataset)
+    // each review is only written by one thread, semantics are thread-safe
+    parallel_for(dataset.size(), threads, [&](std::size_t i)
     {
         if (sparse)
-            review.vector = compress_sparse(review, columns);
+            dataset[i].vector = compress_sparse(dataset[i], columns);
 
         else if (!sparse)
-            review.vector = compress_dense(review, columns);
-    }
+            dataset[i].vector = compress_dense(dataset[i], columns);
+    });
     // at this point, dataset reviews have had their review vectors populated
 }
 
+void compressor::compressed_data(
+                                   corpus & arg,
+                                   const corpus::view & reviews,
+                                   const column_layout & columns,
+                                   bool sparse,
+                                   unsigned int threads
+                                )
+{
+    if (!sparse)
+        prepare_dense(threads);
+
+    parallel_for(reviews.size(), threads, [&](std::size_t k)
+    {
+        std::uint32_t i = reviews[k];
+        arg.vectors[i] = compress(arg.words_of(i), columns, sparse);
+    });
+}
+
+void compressor::pooled_data(
+                               corpus & arg,
+                               const corpus::view & reviews,
+                               bool sparse,
+                               pooling mode,
+                               unsigned int threads
+                            )
+{
+    if (!sparse)
+        prepare_dense(threads);
+
+    parallel_for(reviews.size(), threads, [&](std::size_t k)
+    {
+        std::uint32_t i = reviews[k];
+        arg.vectors[i] = pool(arg.words_of(i), sparse, mode);
+    });
+}
+
+row_table compressor::shared_data(
+                                     const std::vector<data> & dataset,
+                                     const column_layout & columns,
+                                     bool sparse,
+                                     unsigned int threads
+                                   )
+{
+    std::vector<word_range> reviews;
+    for (const data & review : dataset)
+        reviews.push_back(review.words);
+    return shared(reviews, columns, sparse, threads);
+}
+
+row_table compressor::shared_data(
+                                     const corpus & arg,
+                                     const corpus::view & reviews,
+                                     const column_layout & columns,
+                                     bool sparse,
+                                     unsigned int threads
+                                   )
+{
+    std::vector<word_range> ranges;
+    for (std::uint32_t i : reviews.indices)
+        ranges.push_back(arg.words_of(i));
+    return shared(ranges, columns, sparse, threads);
+}
+
+row_table compressor::shared(
+                               const std::vector<word_range> & reviews,
+                               const column_layout & columns,
+                               bool sparse,
+                               unsigned int threads
+                             )
+{
+    if (!sparse)
+        prepare_dense(threads);
+
+    unsigned int keys = enc_keys.size() + non_enc_keys.size();
+    row_table table;
+    table.width = keys;
+    table.columns = columns.columns;
+
+    // distinct words, in order of appearance
+    std::unordered_map<word, unsigned int> ids;
+    std::vector<const word*> distinct;
+    for (const word_range & review : reviews)
+        for (const word & key : review)
+            if (ids.emplace(key, distinct.size()).second)
+                distinct.push_back(&key);
+
+    // one row per distinct word - rows depend only on the word
+    std::vector<thrust::host_vector<float>> rows(distinct.size());
+    std::vector<char> used(distinct.size(), 0);
+    parallel_for(distinct.size(), threads, [&](std::size_t i)
+    {
+        rows[i] = thrust::host_vector<float>(keys);
+        used[i] = encode(*distinct[i], sparse, rows[i].begin());
+    });
+
+    // keep the non-zero rows only: other words are left out of the references
+    std::vector<int> row_ids(distinct.size(), -1);
+    for (unsigned int i = 0; i < distinct.size(); i++)
+    {
+        if (used[i])
+        {
+            row_ids[i] = table.rows.size();
+            table.rows.push_back(std::move(rows[i]));
+        }
+    }
+
+    for (const word_range & review : reviews)
+    {
+        std::vector<row_ref> refs;
+        unsigned int i = 0;
+        for (const word & key : review)
+        {
+            int id = row_ids[ids[key]];
+            int column = columns.column(i++);
+            if (id >= 0 && column >= 0)
+                refs.push_back({unsigned(column), unsigned(id)});
+        }
+        table.refs.push_back(std::move(refs));
+    }
+    return table;
+}
+
 void compressor::uncompressed_data(
                                       std::vector<data> & dataset, 
-                                      const unsigned int columns
+                                      const column_layout & columns
                                   )
 {
     unsigned int keys = enc_keys.size() + non_enc_keys.size();
     for (data & review : dataset)
     {
-        review.vector = thrust::host_vector<float>(keys*columns);
+        review.vector = thrust::host_vector<float>(keys*columns.columns);
         unsigned int i = 0;
-        const std::vector<word> words = review.words;
 
-        // iterate keys in review (copy param)
-        for (const word key : words)
+        // iterate keys in review: one-hot at the column of position `i`
+        for (const word & key : review.words)
         {
-            thrust::host_vector<float> V = sparse_vector(key);
-            thrust::copy(V.begin(), V.end(), review.vector.begin());
-            i++;
+            int column = columns.column(i++);
+            if (column < 0)
+                continue;
+
+            int encodable = enc_keys.find(key);
+            int non_encodable = non_enc_keys.find(key);
+
+            if (encodable >= 0)
+                review.vector[(column*keys) + encodable] = 1.f;
+
+            else if (non_encodable >= 0)
+                review.vector[(column*keys) + enc_keys.size() + non_encodable] = 1.f;
         }
     }
 }
@@ -121,86 +359,98 @@ thrust::host_vector<float> compressor::all_delta_vector(const word & lhs)
 {
     // allocate the key's vector
     thrust::host_vector<float> vector(enc_keys.size());
-    unsigned int i = 0;
-    // find for each `encodable principal key` how similar this key is
-    for (const word & rhs : enc_keys)
+    // find for each candidate `encodable principal key` how similar this key is
+    // all other principals share no graph node with `lhs` and stay zero
+    for (unsigned int i : candidates(sema_blob.related(lhs)))
     {
         // set to squashed delta value
-        vector[i] = sema_blob.make_delta(lhs, rhs);
-        i++;
+        vector[i] = sema_blob.make_delta(lhs, enc_keys.words[i]);
     }
     return std::move(vector);
 }
 
-thrust::host_vector<float> compressor::best_delta_vector(const word & lhs)
+float compressor::best_match(const word & lhs, unsigned int & position)
 {
-    // allocate the key's vector
-    thrust::host_vector<float> vector(enc_keys.size());
-    std::vector<std::pair<float,unsigned int>> V;
-    unsigned int i = 0;
-
-    // find for each `encodable principal key` how similar this key is
-    for (const word & rhs : enc_keys)
-    {
-        auto delta = sema_blob.make_delta(lhs, rhs);
-        if (delta > 0.f)
-            V.push_back(std::make_pair(delta, i));
-        i++;
-    }
+    relatives nodes = sema_blob.related(lhs);
 
-    // find the best (max) delta - and then populate the vector
-    // note: we return MAX because we've already inverted the delta value
-    auto best = std::max_element(V.begin(), V.end(), 
-                                [&](const std::pair<float,unsigned int> & lhs,
-                                    const std::pair<float,unsigned int> & rhs)
-                                { return std::get<0>(lhs) < std::get<0>(rhs); });
-    if (best != V.end())
-        vector[std::get<1>(*best)] = std::get<0>(*best);
+    // order candidates by upper bound (descending) then position (ascending)
+    std::vector<std::pair<float,unsigned int>> V;
+    for (unsigned int i : candidates(nodes))
+        V.push_back(std::make_pair(semantics::delta_bound(nodes.query, nodes.depth,
+                                                          enc_query[i], enc_depth[i]), i));
 
-    return std::move(vector);
-}
+    std::sort(V.begin(), V.end(),
+              [&](const std::pair<float,unsigned int> & lhs,
+                  const std::pair<float,unsigned int> & rhs)
+              { return std::get<0>(lhs) > std::get<0>(rhs)
+                       || (std::get<0>(lhs) == std::get<0>(rhs)
+                           && std::get<1>(lhs) < std::get<1>(rhs)); });
 
-/// calculate a key's presence vector (non-encodable keys)
-/// @note this is a sparse vector
-thrust::host_vector<float> compressor::binary_vector(const word & lhs) 
-{
-    thrust::host_vector<float> vector(non_enc_keys.size());
-    unsigned int i = 0;
-    for (const word & rhs : non_enc_keys)
+    float best = 0.f;
+    for (const std::pair<float,unsigned int> & item : V)
     {
-        // if same - set to one, else set to zero
-        if (lhs.token == rhs.token && lhs.tag == rhs.tag)
+        // nothing left can beat `best`, nor tie it at a lower position
+        if (best > 0.f && (std::get<0>(item) < best
+                           || (std::get<0>(item) == best && std::get<1>(item) > position)))
+            break;
+
+        // the first (lowest position) maximum wins, as in a full scan
+        float delta = sema_blob.make_delta(lhs, enc_keys.words[std::get<1>(item)]);
+        if (delta > best || (delta > 0.f && delta == best && std::get<1>(item) < position))
         {
-            vector[i] = 1.f;
+            best = delta;
+            position = std::get<1>(item);
         }
-        else
-            vector[i] = 0.f;
-        i++;
     }
-    return std::move(vector);
+#ifndef NDEBUG
+    // debug builds check the early exit against a full scan: same delta, same (first) principal
+    thrust::host_vector<float> all = all_delta_vector(lhs);
+    auto full = std::max_element(all.begin(), all.end());
+    assert(full == all.end() || (*full == best && (best == 0.f || unsigned(full - all.begin()) == position)));
+#endif
+    return best;
 }
 
-thrust::host_vector<float> compressor::sparse_vector(const word & lhs)
+void compressor::index_principals()
 {
-    thrust::host_vector<float> vector(enc_keys.size()+non_enc_keys.size());
-    unsigned int i = 0;
-    // iterate encryptable keys first
-    for (const word & rhs : enc_keys)
+    for (unsigned int i = 0; i < enc_keys.size(); i++)
     {
-        if (lhs.token == rhs.token && lhs.tag == rhs.tag)
-            vector[i] = 1.f;
-        else
-            vector[i] = 0.f;
-        i++;
+        relatives nodes = sema_blob.related(enc_keys.words[i]);
+        enc_query.push_back(nodes.query);
+        enc_depth.push_back(nodes.depth);
+
+        for (const std::string & node : nodes.hypernyms)
+            hypernym_index[node].push_back(i);
+
+        for (const std::string & node : nodes.hyponyms)
+            hyponym_index[node].push_back(i);
+
+        for (const std::string & node : nodes.synonyms)
+            synonym_index[node].push_back(i);
     }
-    // iterate non-encryptable keys second
-    for (const word & rhs : non_enc_keys)
+}
+
+std::vector<unsigned int> compressor::candidates(const relatives & nodes)
+{
+    std::vector<unsigned int> result;
+
+    // `make_delta` only intersects graphs of the same relation
+    auto gather = [&](const std::vector<std::string> & graph,
+                      const std::unordered_map<std::string, std::vector<unsigned int>> & index)
     {
-        if (lhs.token == rhs.token && lhs.tag == rhs.tag)
-            vector[i] = 1.f;
-        else
-            vector[i] = 0.f;
-        i++;
-    }
-    return std::move(vector);
+        for (const std::string & node : graph)
+        {
+            auto it = index.find(node);
+            if (it != index.end())
+                result.insert(result.end(), it->second.begin(), it->second.end());
+        }
+    };
+    gather(nodes.hypernyms, hypernym_index);
+    gather(nodes.hyponyms, hyponym_index);
+    gather(nodes.synonyms, synonym_index);
+
+    // ascending and unique positions
+    std::sort(result.begin(), result.end());
+    result.erase(std::unique(result.begin(), result.end()), result.end());
+    return result;
 }
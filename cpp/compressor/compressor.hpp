@@ -2,6 +2,90 @@
 #define NLP_ENCODER_COMPRESSOR
 #include "includes.ihh"
 ///
+/// pooling of a review's word rows into a single `keys` wide vector
+///
+enum class pooling
+{
+    sum,    // sum of the word rows
+    mean,   // sum divided by the review's word count
+    max,    // element-wise maximum
+    tf      // distinct word rows weighted by sublinear term frequency `1 + ln(count)`, normalised
+};
+///
+/// maps word positions to the columns of a review vector:
+/// the first `exact` positions have their own column, the following positions
+/// share logarithmic buckets (`[exact*2^j, exact*2^(j+1))` into column `exact+j`)
+/// up to `columns`, further positions are truncated.
+/// rows merged into one column keep their element-wise maximum
+///
+struct column_layout
+{
+    /// one column per position, truncated at @param columns
+    column_layout(unsigned int columns)
+    : columns(columns), exact(columns)
+    {}
+
+    /// truncate at the length of the @param p percentile (0, 1] of @param dataset reviews
+    static column_layout percentile(const std::vector<data> & dataset, float p)
+    {
+        std::vector<unsigned int> lengths;
+        for (const data & review : dataset)
+            lengths.push_back(review.words.size());
+        return percentile(std::move(lengths), p);
+    }
+
+    /// truncate at the length of the @param p percentile of the @param reviews of @param arg
+    static column_layout percentile(const corpus & arg, const corpus::view & reviews, float p)
+    {
+        std::vector<unsigned int> lengths;
+        for (std::uint32_t i : reviews.indices)
+            lengths.push_back(arg.words_of(i).size());
+        return percentile(std::move(lengths), p);
+    }
+
+    /// truncate at the @param p percentile of the review @param lengths
+    static column_layout percentile(std::vector<unsigned int> && lengths, float p)
+    {
+        if (p <= 0.f || p > 1.f)
+            throw std::runtime_error("column percentile must be in (0, 1]");
+        if (lengths.empty())
+            return column_layout(0);
+
+        auto nth = lengths.begin() + std::size_t(std::ceil(p * lengths.size()) - 1);
+        std::nth_element(lengths.begin(), nth, lengths.end());
+        return column_layout(*nth);
+    }
+
+    /// @param exact positions of their own, then logarithmic buckets covering @param longest positions
+    static column_layout log_buckets(unsigned int longest, unsigned int exact)
+    {
+        if (exact == 0)
+            throw std::runtime_error("log buckets need at least one exact position");
+
+        column_layout result(std::min(longest, exact));
+        for (unsigned int end = exact; end < longest; end *= 2)
+            result.columns++;
+        return result;
+    }
+
+    /// @return the column of word position @param position, or -1 if it's truncated
+    inline int column(unsigned int position) const
+    {
+        if (position < exact)
+            return position;
+
+        unsigned int bucket = exact;
+        for (unsigned int end = exact * 2; end <= position; end *= 2)
+            bucket++;
+        return bucket < columns ? int(bucket) : -1;
+    }
+
+    // columns of a review vector
+    unsigned int columns;
+    // leading positions with a column of their own
+    unsigned int exact;
+};
+///
 /// vectorizes a dataset into a matrix of representational values
 ///
 struct compressor
@@ -9,6 +93,8 @@ struct compressor
     /// create a compressor by passing reference to semantics
     /// and @param size defines how big will be the final buffer.
     /// The `buffer_size` is the amount of (vectorized) keys
+    /// principals are frozen into vocabularies: encodable keys take the first
+    /// columns of each position, non-encodable keys the rest
     compressor(
                 semantics & sema_handler,
                 const std::unordered_set<word> encodable,
@@ -17,46 +103,155 @@ struct compressor
     : sema_blob(sema_handler), 
       enc_keys(encodable), 
       non_enc_keys(non_encodable)
-    {}
+    {
+        index_principals();
+    }
 
     /// compress a sparse vector from @param arg
-    thrust::host_vector<float> compress_sparse(const data & arg, const unsigned int columns);
+    thrust::host_vector<float> compress_sparse(const data & arg, const column_layout & columns);
 
     /// compress a dense vector from @param arg
-    thrust::host_vector<float> compress_dense(const data & arg, const unsigned int columns);
+    /// @note uses the shared rows of `prepare_dense` once prepared
+    thrust::host_vector<float> compress_dense(const data & arg, const column_layout & columns);
+
+    /// @return the (encodable + non-encodable) wide row of @param key, sparse or dense
+    /// zero if @param key isn't a principal
+    thrust::host_vector<float> row(const word & key, bool sparse);
+
+    /// calculate the dense (all delta) row of every encodable principal once, on @param threads (0 uses all cores)
+    /// rows depend only on the word, so all reviews share them
+    void prepare_dense(unsigned int threads = 0);
 
     /// convert @param dataset into a vectorized matrix of @param columns
     /// @warning: dataset will be modified - @param sparse defines the nature of the vector
-    void compressed_data(std::vector<data> & dataset, const unsigned int columns, bool sparse);
+    /// reviews are encoded independently on @param threads threads (0 uses all cores),
+    /// each review's vector is the same whatever the thread count
+    void compressed_data(
+                          std::vector<data> & dataset,
+                          const column_layout & columns,
+                          bool sparse,
+                          unsigned int threads = 0
+                        );
+
+    /// pool the word rows (sparse or dense) of @param arg into one `keys` wide vector
+    /// @note position independent: the output width doesn't depend on the review length
+    thrust::host_vector<float> compress_pooled(const data & arg, bool sparse, pooling mode);
+
+    /// convert @param dataset into pooled `keys` wide vectors, on @param threads threads (0 uses all cores)
+    /// @warning: dataset will be modified
+    void pooled_data(
+                      std::vector<data> & dataset,
+                      bool sparse,
+                      pooling mode,
+                      unsigned int threads = 0
+                    );
+
+    /// encode @param dataset as a `row_table`: each distinct word's row is calculated
+    /// and stored once, reviews hold (position, row) references to the shared rows
+    /// @note row_table::expand gives the same vectors as `compressed_data`
+    row_table shared_data(
+                           const std::vector<data> & dataset,
+                           const column_layout & columns,
+                           bool sparse,
+                           unsigned int threads = 0
+                         );
+
+    /// vectorize the @param reviews of @param arg into `corpus::vectors`, as `compressed_data`
+    void compressed_data(
+                          corpus & arg,
+                          const corpus::view & reviews,
+                          const column_layout & columns,
+                          bool sparse,
+                          unsigned int threads = 0
+                        );
+
+    /// encode the @param reviews of @param arg as a `row_table`, as `shared_data`
+    row_table shared_data(
+                           const corpus & arg,
+                           const corpus::view & reviews,
+                           const column_layout & columns,
+                           bool sparse,
+                           unsigned int threads = 0
+                         );
+
+    /// vectorize the @param reviews of @param arg into pooled `corpus::vectors`, as `pooled_data`
+    void pooled_data(
+                      corpus & arg,
+                      const corpus::view & reviews,
+                      bool sparse,
+                      pooling mode,
+                      unsigned int threads = 0
+                    );
 
     /// do a sparse encoding (no compression at all) used as baseline test
-    void uncompressed_data(std::vector<data> & dataset, const unsigned int columns);
+    void uncompressed_data(std::vector<data> & dataset, const column_layout & columns);
+
+    /// encodable principal keys, by column
+    const vocabulary & encodable() const
+    {
+        return enc_keys;
+    }
+
+    /// non-encodable principal keys, by column (after the encodable keys)
+    const vocabulary & non_encodable() const
+    {
+        return non_enc_keys;
+    }
 
 private:
 
-    /// calculate a key's similarity vector using semantics (encodable keys)
-    /// this version will obtain all possible deltas for a keyword
-    /// @note: this is a dense vector
-    thrust::host_vector<float> all_delta_vector(const word & key); 
+    /// build the inverted index of graph nodes to encodable principals
+    void index_principals();
+
+    /// compress the word rows of @param arg into their @param columns
+    thrust::host_vector<float> compress(word_range arg, const column_layout & columns, bool sparse);
+
+    /// the `row_table` of the words of @param reviews, @see `shared_data`
+    row_table shared(
+                      const std::vector<word_range> & reviews,
+                      const column_layout & columns,
+                      bool sparse,
+                      unsigned int threads
+                    );
 
-    /// calculate a key's similarity vector using semantics
-    /// this version will obtain only the best delta for a keyword
-    /// @note this is a sparse vector
-    thrust::host_vector<float> best_delta_vector(const word & key);
+    /// pool the word rows of @param arg, @see `compress_pooled`
+    thrust::host_vector<float> pool(word_range arg, bool sparse, pooling mode);
 
-    /// calculate a key's presence vector (non-encodable keys)
-    /// @note this is a sparse vector
-    thrust::host_vector<float> binary_vector(const word & key);
+    /// write the row of @param key (sparse or dense) at @param row, which must be zeroed
+    /// @return false if the row stays zero (the key isn't a principal, or has no delta)
+    bool encode(const word & key, bool sparse, thrust::host_vector<float>::iterator row);
 
-    /// calculate key's presence as a sparse (no compression) vector
-    thrust::host_vector<float> sparse_vector(const word & key);
+    /// find the encodable principals (by position) sharing at least one graph node with @param nodes
+    /// @note principals outside this list always have a zero delta to the word of @param nodes
+    std::vector<unsigned int> candidates(const relatives & nodes);
 
+    /// find the encodable principal with the largest delta to @param key
+    /// candidates are visited by descending `semantics::delta_bound` and the search
+    /// stops once no remaining candidate can beat (or tie at a lower position) the best
+    /// @return the best delta (zero if none) and set @param position to its principal
+    /// @note without NDEBUG, each result is asserted against `all_delta_vector`
+    float best_match(const word & key, unsigned int & position);
+
+    /// calculate a key's similarity vector using semantics (encodable keys)
+    /// this version will obtain all possible deltas for a keyword
+    /// @note: this is a dense vector
+    thrust::host_vector<float> all_delta_vector(const word & key); 
 
     /// semantic blob reference
     semantics & sema_blob;
     /// encodable principal keys
-    const std::unordered_set<word> enc_keys;
+    const vocabulary enc_keys;
     /// non-encodable principal keys
-    const std::unordered_set<word> non_enc_keys;
+    const vocabulary non_enc_keys;
+    /// sense query and hypernym graph depth of each encodable principal
+    /// @see `relatives::query` and `relatives::depth`
+    std::vector<std::string> enc_query;
+    std::vector<int> enc_depth;
+    /// dense (all delta) row of each encodable principal, empty until `prepare_dense`
+    std::vector<thrust::host_vector<float>> enc_rows;
+    /// inverted indices: graph node to positions of the principals whose graph contains it
+    std::unordered_map<std::string, std::vector<unsigned int>> hypernym_index;
+    std::unordered_map<std::string, std::vector<unsigned int>> hyponym_index;
+    std::unordered_map<std::string, std::vector<unsigned int>> synonym_index;
 };
 #endif 
@@ -0,0 +1,293 @@
+#include "container.hpp"
+
+/// sections are aligned to cache lines (and any typed-array element)
+static const std::uint64_t alignment = 64;
+
+static std::uint64_t align(std::uint64_t offset)
+{
+    return (offset + alignment - 1) / alignment * alignment;
+}
+
+const std::size_t section_writer::capacity;
+
+section_writer::section_writer(const std::string & filename)
+: filename(filename),
+  file(filename, std::ios::in | std::ios::out | std::ios::binary | std::ios::trunc)
+{
+    if (!file)
+        throw std::runtime_error("couldn't write to file `"+filename+"`");
+    buffer.reserve(capacity);
+}
+
+void section_writer::put(const void * data, std::size_t size)
+{
+    const char * bytes = static_cast<const char*>(data);
+    offset += size;
+    // large blocks skip the buffer
+    if (size >= capacity)
+    {
+        flush();
+        file.write(bytes, size);
+        return;
+    }
+    if (buffer.size() + size > capacity)
+        flush();
+    buffer.insert(buffer.end(), bytes, bytes + size);
+}
+
+void section_writer::pad()
+{
+    static const char zeros[alignment] = {};
+    put(zeros, align(offset) - offset);
+}
+
+void section_writer::append(section_writer & other)
+{
+    other.flush();
+    other.file.seekg(0);
+    std::vector<char> block(capacity);
+    for (std::uint64_t left = other.offset; left > 0; )
+    {
+        std::size_t size = std::min<std::uint64_t>(left, capacity);
+        if (!other.file.read(block.data(), size))
+            throw std::runtime_error("failed reading `"+other.filename+"`");
+        put(block.data(), size);
+        left -= size;
+    }
+}
+
+void section_writer::patch(std::uint64_t at, const void * data, std::size_t size)
+{
+    flush();
+    file.seekp(at);
+    file.write(static_cast<const char*>(data), size);
+    file.seekp(0, std::ios::end);
+}
+
+void section_writer::flush()
+{
+    file.write(buffer.data(), buffer.size());
+    buffer.clear();
+    file.flush();
+    if (!file)
+        throw std::runtime_error("failed writing `"+filename+"`");
+}
+
+container_writer::container_writer(
+                                    const std::string & filename,
+                                    const vocabulary & encodable,
+                                    const vocabulary & non_encodable,
+                                    unsigned int columns,
+                                    std::uint64_t width,
+                                    bool csr,
+                                    dtype values
+                                  )
+: out(filename),
+  scores(filename + ".scores"),
+  indptr(filename + ".indptr"),
+  indices(filename + ".indices"),
+  narrowed(width * size_of(values))
+{
+    if (csr && width > UINT32_MAX)
+        throw std::runtime_error("container csr indices are 32 bits");
+
+    std::string words;
+    for (const ::vocabulary * keys : {&encodable, &non_encodable})
+        for (const word & key : keys->words)
+            words += key.token() + "\t" + key.tag() + "\n";
+
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, "WVC1", 4);
+    header.version = 1;
+    header.dtype = static_cast<std::uint32_t>(values);
+    header.csr = csr;
+    header.width = width;
+    header.encodable = encodable.size();
+    header.non_encodable = non_encodable.size();
+    header.columns = columns;
+    header.vocabulary_offset = align(sizeof(header));
+    header.vocabulary_bytes = words.size();
+    header.values_offset = align(header.vocabulary_offset + words.size());
+
+    // the header is rewritten by `close`, once the sizes are known
+    out.put(&header, sizeof(header));
+    out.pad();
+    out.put(words.data(), words.size());
+    out.pad();
+
+    std::uint64_t first = 0;
+    if (csr)
+        indptr.put(&first, sizeof(first));
+}
+
+container_writer::~container_writer()
+{
+    for (const section_writer * side : {&scores, &indptr, &indices})
+        std::remove(side->filename.c_str());
+}
+
+void container_writer::write(float score, const thrust::host_vector<float> & vector)
+{
+    if (closed)
+        throw std::runtime_error("container is closed");
+    if (vector.size() != header.width)
+        throw std::runtime_error("container reviews must have vectors of one size");
+
+    dtype values = static_cast<dtype>(header.dtype);
+    header.rows++;
+    scores.put(&score, sizeof(score));
+    if (!header.csr)
+    {
+        header.nnz += header.width;
+        if (header.width == 0)
+            return;
+        narrow(&vector[0], header.width, values, narrowed.data());
+        out.put(narrowed.data(), narrowed.size());
+        return;
+    }
+
+    nonzero.clear();
+    for (std::uint32_t k = 0; k < header.width; k++)
+    {
+        if (vector[k] != 0.f)
+        {
+            indices.put(&k, sizeof(k));
+            nonzero.push_back(vector[k]);
+        }
+    }
+    header.nnz += nonzero.size();
+    indptr.put(&header.nnz, sizeof(header.nnz));
+    narrow(nonzero.data(), nonzero.size(), values, narrowed.data());
+    out.put(narrowed.data(), nonzero.size() * size_of(values));
+}
+
+void container_writer::close()
+{
+    if (closed)
+        return;
+
+    out.pad();
+    header.scores_offset = out.offset;
+    out.append(scores);
+    if (header.csr)
+    {
+        out.pad();
+        header.indptr_offset = out.offset;
+        out.append(indptr);
+        out.pad();
+        header.indices_offset = out.offset;
+        out.append(indices);
+    }
+    out.patch(0, &header, sizeof(header));
+    out.flush();
+    closed = true;
+}
+
+void save_container(
+                     const std::string & filename,
+                     const std::vector<data> & dataset,
+                     const vocabulary & encodable,
+                     const vocabulary & non_encodable,
+                     unsigned int columns,
+                     bool csr,
+                     dtype values
+                   )
+{
+    std::uint64_t width = dataset.empty() ? 0 : dataset[0].vector.size();
+    container_writer out(filename, encodable, non_encodable, columns, width, csr, values);
+    out.write(dataset);
+    out.close();
+}
+
+mapped_container::mapped_container(const std::string & filename)
+{
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0)
+        throw std::runtime_error("couldn't read file: "+filename);
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || std::size_t(info.st_size) < sizeof(container_header))
+    {
+        close(fd);
+        throw std::runtime_error("not a container: "+filename);
+    }
+    size = info.st_size;
+    // private (copy-on-write) pages: writes through a view never reach the file
+    void * mapped = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapped == MAP_FAILED)
+        throw std::runtime_error("couldn't map file: "+filename);
+    base = static_cast<const char*>(mapped);
+
+    try
+    {
+        validate(filename);
+    }
+    catch (...)
+    {
+        munmap(const_cast<char*>(base), size);
+        throw;
+    }
+}
+
+/// does a section of @param count elements of @param bytes at @param offset
+/// lie within (and start aligned in) a file of @param size bytes?
+static bool fits(std::uint64_t offset, std::uint64_t count, std::uint64_t bytes, std::uint64_t size)
+{
+    return offset <= size && offset % bytes == 0 && count <= (size - offset) / bytes;
+}
+
+void mapped_container::validate(const std::string & filename) const
+{
+    const container_header & h = header();
+    if (std::memcmp(h.magic, "WVC1", 4) != 0 || h.version != 1)
+        throw std::runtime_error("not a version 1 container: "+filename);
+    if (h.dtype > static_cast<std::uint32_t>(dtype::uint8))
+        throw std::runtime_error("unknown container dtype: "+filename);
+
+    // every section must lie inside the file, whatever the header claims
+    bool valid = fits(h.vocabulary_offset, h.vocabulary_bytes, 1, size)
+              && fits(h.scores_offset, h.rows, sizeof(float), size)
+              && fits(h.values_offset, h.nnz, size_of(values_type()), size);
+    if (valid && h.csr)
+        valid = h.rows < std::numeric_limits<std::uint64_t>::max()
+             && fits(h.indptr_offset, h.rows + 1, sizeof(std::uint64_t), size)
+             && fits(h.indices_offset, h.nnz, sizeof(std::uint32_t), size);
+    else if (valid)
+        valid = h.width == 0 ? h.nnz == 0 : h.rows <= h.nnz / h.width && h.rows * h.width == h.nnz;
+    if (!valid)
+        throw std::runtime_error("truncated or corrupt container: "+filename);
+
+    // rows index [indptr[row], indptr[row + 1]) of indices and values
+    if (h.csr)
+    {
+        const std::uint64_t * pointers = indptr();
+        if (pointers[0] != 0 || pointers[h.rows] != h.nnz)
+            throw std::runtime_error("corrupt container indptr: "+filename);
+        for (std::uint64_t row = 0; row < h.rows; ++row)
+            if (pointers[row] > pointers[row + 1])
+                throw std::runtime_error("corrupt container indptr: "+filename);
+    }
+}
+
+mapped_container::~mapped_container()
+{
+    munmap(const_cast<char*>(base), size);
+}
+
+std::vector<std::pair<std::string, std::string>> mapped_container::vocabulary() const
+{
+    std::vector<std::pair<std::string, std::string>> result;
+    const char * it = base + header().vocabulary_offset;
+    const char * end = it + header().vocabulary_bytes;
+    while (it < end)
+    {
+        const char * tab = static_cast<const char*>(std::memchr(it, '\t', end - it));
+        const char * eol = static_cast<const char*>(std::memchr(it, '\n', end - it));
+        if (!tab || !eol || tab > eol)
+            throw std::runtime_error("corrupt container vocabulary");
+        result.push_back(std::make_pair(std::string(it, tab), std::string(tab + 1, eol)));
+        it = eol + 1;
+    }
+    return result;
+}
@@ -0,0 +1,226 @@
+#ifndef NLP_ENCODER_CONTAINER
+#define NLP_ENCODER_CONTAINER
+#include "includes.ihh"
+///
+/// binary container of review vectors, readable in place (mmap) without parsing.
+/// Layout (native, little-endian), every section starts at a multiple of 64 bytes:
+///
+///   header      `container_header`
+///   vocabulary  `token\ttag\n` per principal, encodable keys first (by column)
+///   values      dtype[rows * width] (dense) or dtype[nnz] (csr)
+///   scores      float32[rows]
+///   csr:        indptr  uint64[rows + 1], indices uint32[nnz]
+///
+/// Readers go by the header offsets, not by this order. Unused section offsets are zero
+///
+struct container_header
+{
+    // "WVC1"
+    char magic[4];
+    // format version
+    std::uint32_t version;
+    // value type, @see `dtype`
+    std::uint32_t dtype;
+    // 0 dense, 1 csr
+    std::uint32_t csr;
+    // reviews, values per review (principals * columns) and stored values
+    std::uint64_t rows;
+    std::uint64_t width;
+    std::uint64_t nnz;
+    // principals and columns
+    std::uint32_t encodable;
+    std::uint32_t non_encodable;
+    std::uint32_t columns;
+    std::uint32_t reserved;
+    // section offsets and the vocabulary size, in bytes
+    std::uint64_t vocabulary_offset;
+    std::uint64_t vocabulary_bytes;
+    std::uint64_t scores_offset;
+    std::uint64_t indptr_offset;
+    std::uint64_t indices_offset;
+    std::uint64_t values_offset;
+};
+static_assert(sizeof(container_header) == 104, "container header must be packed");
+///
+/// buffered, sequential output of one container section to a file
+///
+struct section_writer
+{
+    explicit section_writer(const std::string & filename);
+
+    void put(const void * data, std::size_t size);
+
+    /// zero pad up to the next section alignment
+    void pad();
+
+    /// copy the whole file written by @param other (flushed) here
+    void append(section_writer & other);
+
+    /// overwrite @param size bytes at @param offset, then carry on at the end
+    void patch(std::uint64_t offset, const void * data, std::size_t size);
+
+    void flush();
+
+    static const std::size_t capacity = 1 << 22;
+    std::string filename;
+    std::fstream file;
+    std::vector<char> buffer;
+    // bytes written so far
+    std::uint64_t offset = 0;
+};
+///
+/// streams review vectors into a container file a review at a time, dense or `csr`.
+/// Values go straight to the file, scores and csr arrays to side files which `close`
+/// appends - so memory use doesn't grow with the reviews. Values are stored narrowed
+/// to `values`, csr keeps every non-zero float even if it narrows to zero
+///
+class container_writer
+{
+public:
+
+    /// vectors of @param width values (principals * @param columns)
+    container_writer(
+                      const std::string & filename,
+                      const vocabulary & encodable,
+                      const vocabulary & non_encodable,
+                      unsigned int columns,
+                      std::uint64_t width,
+                      bool csr,
+                      dtype values = dtype::float32
+                    );
+
+    /// removes the side files, the container is complete only after `close`
+    ~container_writer();
+
+    /// No Copying allowed
+    container_writer(const container_writer &) = delete;
+
+    // No assignment Allowed
+    container_writer& operator=(const container_writer &) = delete;
+
+    /// append one review
+    void write(float score, const thrust::host_vector<float> & vector);
+
+    /// append the reviews of @param dataset
+    void write(const std::vector<data> & dataset)
+    {
+        for (const data & review : dataset)
+            write(review.score, review.vector);
+    }
+
+    /// append the @param reviews of @param arg
+    void write(const corpus & arg, const corpus::view & reviews)
+    {
+        for (std::uint32_t i : reviews.indices)
+            write(arg.scores[i], arg.vectors[i]);
+    }
+
+    /// append the side sections and write the final header
+    void close();
+
+private:
+
+    container_header header;
+    section_writer out;
+    section_writer scores;
+    section_writer indptr;
+    section_writer indices;
+    // narrowed values and non-zero floats of a review
+    std::vector<char> narrowed;
+    std::vector<float> nonzero;
+    bool closed = false;
+};
+///
+/// write the vectors of @param dataset into a container file, @see `container_writer`
+/// - all vectors must have the same size
+///
+void save_container(
+                     const std::string & filename,
+                     const std::vector<data> & dataset,
+                     const vocabulary & encodable,
+                     const vocabulary & non_encodable,
+                     unsigned int columns,
+                     bool csr,
+                     dtype values = dtype::float32
+                   );
+///
+/// memory map of a container file: sections are used in place.
+/// The mapping is private, so writes through its (js) views never change the file
+///
+class mapped_container
+{
+public:
+
+    explicit mapped_container(const std::string & filename);
+
+    ~mapped_container();
+
+    /// No Copying allowed
+    mapped_container(const mapped_container &) = delete;
+
+    // No assignment Allowed
+    mapped_container& operator=(const mapped_container &) = delete;
+
+    const container_header & header() const
+    {
+        return *reinterpret_cast<const container_header*>(base);
+    }
+
+    /// the principals (token/tag) by column
+    std::vector<std::pair<std::string, std::string>> vocabulary() const;
+
+    const float * scores() const
+    {
+        return section<float>(header().scores_offset);
+    }
+
+    /// value type of `values`
+    dtype values_type() const
+    {
+        return static_cast<dtype>(header().dtype);
+    }
+
+    /// dense: the values of review @param row
+    const void * row(std::uint64_t row) const
+    {
+        return section<char>(header().values_offset) + row * header().width * size_of(values_type());
+    }
+
+    /// csr arrays
+    const std::uint64_t * indptr() const
+    {
+        return section<std::uint64_t>(header().indptr_offset);
+    }
+
+    const std::uint32_t * indices() const
+    {
+        return section<std::uint32_t>(header().indices_offset);
+    }
+
+    /// `values_type` values: `rows` * `width` (dense) or `nnz` (csr)
+    const void * values() const
+    {
+        return section<char>(header().values_offset);
+    }
+
+    /// @return value @param index of `values`, as a float
+    float value(std::uint64_t index) const
+    {
+        return widen(values(), index, values_type());
+    }
+
+private:
+
+    /// throws unless the header and every section fit the mapped file
+    void validate(const std::string & filename) const;
+
+    template <class T>
+    const T * section(std::uint64_t offset) const
+    {
+        return offset ? reinterpret_cast<const T*>(base + offset) : nullptr;
+    }
+
+    const char * base = nullptr;
+    std::size_t size = 0;
+};
+#endif
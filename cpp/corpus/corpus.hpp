@@ -0,0 +1,164 @@
+#ifndef NLP_ENCODER_CORPUS
+#define NLP_ENCODER_CORPUS
+#include "includes.ihh"
+///
+/// columnar (struct of arrays) data-set: review texts share one arena,
+/// review words one flat array, each addressed by per-review offsets.
+/// Scores and review vectors are separate arrays, indexed by review.
+/// Filtering and partitioning produce `view`s (review indices) instead of copies
+///
+struct corpus
+{
+    ///
+    /// an ordered subset of the corpus reviews, by index
+    ///
+    struct view
+    {
+        inline std::size_t size() const
+        {
+            return indices.size();
+        }
+
+        inline std::uint32_t operator[](std::size_t i) const
+        {
+            return indices[i];
+        }
+
+        std::vector<std::uint32_t> indices;
+    };
+
+    corpus() = default;
+
+    /// copy the reviews, scores and words (if tagged) of @param dataset
+    explicit corpus(const std::vector<data> & dataset)
+    {
+        for (const data & review : dataset)
+        {
+            push_back(review.review, review.score);
+            words.insert(words.end(), review.words.begin(), review.words.end());
+            word_offsets.back() = words.size();
+        }
+    }
+
+    /// append an untagged review
+    void push_back(const std::string & review, float score)
+    {
+        push_back(review.data(), review.data() + review.size(), score);
+    }
+
+    /// append the untagged review of bytes [@param first, @param last)
+    void push_back(const char * first, const char * last, float score)
+    {
+        // views address reviews by 32 bit indices
+        if (size() >= UINT32_MAX)
+            throw std::runtime_error("corpus: too many reviews");
+
+        text.append(first, last);
+        text_offsets.push_back(text.size());
+        word_offsets.push_back(words.size());
+        scores.push_back(score);
+        vectors.emplace_back();
+    }
+
+    /// @return the amount of reviews
+    inline std::size_t size() const
+    {
+        return scores.size();
+    }
+
+    /// @return the text of review @param i
+    inline std::string review(std::size_t i) const
+    {
+        return text.substr(text_offsets[i], text_offsets[i+1] - text_offsets[i]);
+    }
+
+    /// @return the words of review @param i
+    inline word_range words_of(std::size_t i) const
+    {
+        return word_range(words.data() + word_offsets[i], words.data() + word_offsets[i+1]);
+    }
+
+    /// replace the words of all reviews, @param offsets has `size() + 1` entries
+    void assign_words(std::vector<word> && flat, std::vector<std::uint64_t> && offsets)
+    {
+        if (offsets.size() != size() + 1 || offsets.back() != flat.size())
+            throw std::runtime_error("corpus: word offsets don't match the reviews");
+
+        words = std::move(flat);
+        word_offsets = std::move(offsets);
+    }
+
+    /// @return a view of all reviews
+    view all() const
+    {
+        view result;
+        result.indices.resize(size());
+        for (std::uint32_t i = 0; i < size(); i++)
+            result.indices[i] = i;
+        return result;
+    }
+
+    /// @return the reviews of @param arg with less than @param max_length words
+    view filter(const view & arg, unsigned int max_length) const
+    {
+        view result;
+        for (std::uint32_t i : arg.indices)
+            if (word_offsets[i+1] - word_offsets[i] < max_length)
+                result.indices.push_back(i);
+        return result;
+    }
+
+    /// @return the largest word count of the reviews of @param arg
+    unsigned int max_size(const view & arg) const
+    {
+        unsigned int largest = 0;
+        for (std::uint32_t i : arg.indices)
+            largest = std::max<std::uint64_t>(largest, word_offsets[i+1] - word_offsets[i]);
+        return largest;
+    }
+
+    /// randomly partition @param arg into a training and a testing view (around 4/1),
+    /// the same @param seed gives the same partition
+    std::pair<view, view> random_partition(const view & arg, unsigned int seed) const
+    {
+        std::vector<std::uint32_t> shuffled = arg.indices;
+        std::mt19937 generator(seed);
+        std::shuffle(shuffled.begin(), shuffled.end(), generator);
+
+        std::size_t train_size = (4.f/5.f) * shuffled.size();
+        view train, test;
+        train.indices.assign(shuffled.begin(), shuffled.begin() + train_size);
+        test.indices.assign(shuffled.begin() + train_size, shuffled.end());
+        return std::make_pair(std::move(train), std::move(test));
+    }
+
+    /// copy the reviews of @param arg out as `data` rows
+    std::vector<data> to_data(const view & arg) const
+    {
+        std::vector<data> result(arg.size());
+        for (std::size_t k = 0; k < arg.size(); k++)
+        {
+            std::uint32_t i = arg[k];
+            word_range range = words_of(i);
+            result[k].review = review(i);
+            result[k].words.assign(range.begin(), range.end());
+            result[k].score = scores[i];
+            result[k].vector = vectors[i];
+        }
+        return result;
+    }
+
+    // review texts, back to back
+    std::string text;
+    // arena offset of each review text, and the arena end
+    std::vector<std::uint64_t> text_offsets = {0};
+    // review words, back to back
+    std::vector<word> words;
+    // `words` offset of each review, and the array end
+    std::vector<std::uint64_t> word_offsets = {0};
+    // review scores
+    std::vector<float> scores;
+    // vectorized reviews
+    std::vector<thrust::host_vector<float>> vectors;
+};
+#endif
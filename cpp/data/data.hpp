@@ -2,44 +2,68 @@
 #define NLP_ENCODER_DATA
 #include "includes.ihh"
 ///
-/// word used for data and others
+/// word used for data and others: interned token and POS tag ids (@see `symbols`)
+/// with a precomputed hash - comparing and hashing words never touches strings
 ///
 struct word
 {
-    std::string token;
-    std::string tag;
+    word()
+    : word(std::uint32_t(0), std::uint8_t(0))
+    {}
+
+    word(const std::string & token, const std::string & tag)
+    : word(symbols::singleton().token(token), symbols::singleton().tag(tag))
+    {}
+
+    word(const std::string & token, penn tag)
+    : word(symbols::singleton().token(token), static_cast<std::uint8_t>(tag))
+    {}
+
+    word(std::uint32_t token, std::uint8_t tag)
+    : token_id(token),
+      hash(std::uint32_t(((std::uint64_t(token) << 8 | tag) * 0x9e3779b97f4a7c15ULL) >> 32)),
+      tag_id(tag)
+    {}
+
+    /// @return the token string
+    /// @throw for a `symbols::unknown` token
+    inline const std::string & token() const
+    {
+        return symbols::singleton().token(token_id);
+    }
+
+    /// @return the POS tag string
+    inline const std::string & tag() const
+    {
+        return symbols::singleton().tag(tag_id);
+    }
+
+    /// @return the POS tag - past `penn::count` for non-Penn tags
+    inline penn pos() const
+    {
+        return static_cast<penn>(tag_id);
+    }
 
     inline bool operator==(const word & rhs) const
     {
-        return token == rhs.token && tag == rhs.tag;
+        return token_id == rhs.token_id && tag_id == rhs.tag_id;
     }
+
+    std::uint32_t token_id;
+    std::uint32_t hash;
+    std::uint8_t tag_id;
 };
 ///
-/// Triplet
+/// Triplet: a word and its frequency
 ///
 struct triplet
 {
-    std::string token;
-    std::string tag;
+    word key;
     unsigned int freq;
 
     inline bool operator==(const triplet & rhs) const
     {
-        return token == rhs.token && tag == rhs.tag;
-    }
-};
-///
-/// smnet::delta_path does not take into account POS tags
-///
-struct delta
-{
-    word from;
-    word to;
-    float value;
-
-    inline bool operator==(const delta & rhs) const
-    {
-        return from == rhs.from && to == rhs.to;
+        return key == rhs.key;
     }
 };
 ///
@@ -48,38 +72,19 @@ struct delta
 namespace std
 {
 template<>
-struct hash<triplet>
-{
-    std::size_t operator()(triplet const& arg) const 
-    {
-        std::size_t seed = 0;
-        boost::hash_combine(seed, arg.token);
-        boost::hash_combine(seed, arg.tag);
-        return seed;
-    }
-};
-template<>
 struct hash<word>
 {
     std::size_t operator()(word const& arg) const 
     {
-        std::size_t seed = 0;
-        boost::hash_combine(seed, arg.token);
-        boost::hash_combine(seed, arg.tag);
-        return seed;
+        return arg.hash;
     }
 };
 template<>
-struct hash<delta>
+struct hash<triplet>
 {
-    std::size_t operator()(delta const& arg) const 
+    std::size_t operator()(triplet const& arg) const 
     {
-        std::size_t seed = 0;
-        boost::hash_combine(seed, arg.from.token);
-        boost::hash_combine(seed, arg.from.tag);
-        boost::hash_combine(seed, arg.to.token);
-        boost::hash_combine(seed, arg.to.tag);
-        return seed;
+        return arg.key.hash;
     }
 };
 template<typename T, typename... Args>
@@ -89,6 +94,57 @@ std::unique_ptr<T> make_unique(Args&&... args)
 }
 }
 ///
+/// a frozen, indexed set of words: each word has a fixed position (column)
+/// words are ordered by token, then tag - so the layout is deterministic
+///
+struct vocabulary
+{
+    vocabulary() = default;
+
+    vocabulary(const std::unordered_set<word> & keys)
+    {
+        // the strings are fetched once per word, not per comparison
+        struct keyed
+        {
+            const std::string * token;
+            const std::string * tag;
+            word key;
+        };
+        std::vector<keyed> sorted;
+        sorted.reserve(keys.size());
+        for (const word & key : keys)
+            sorted.push_back({&key.token(), &key.tag(), key});
+
+        std::sort(sorted.begin(), sorted.end(),
+                  [](const keyed & lhs, const keyed & rhs)
+                  { return *lhs.token < *rhs.token
+                           || (lhs.key.token_id == rhs.key.token_id && *lhs.tag < *rhs.tag); });
+
+        for (const keyed & item : sorted)
+        {
+            positions[item.key] = words.size();
+            words.push_back(item.key);
+        }
+    }
+
+    /// @return the position of @param key, or -1 if it isn't in the vocabulary
+    inline int find(const word & key) const
+    {
+        auto it = positions.find(key);
+        return it != positions.end() ? int(it->second) : -1;
+    }
+
+    inline unsigned int size() const
+    {
+        return words.size();
+    }
+
+    // words by position
+    std::vector<word> words;
+    // position of each word
+    std::unordered_map<word, unsigned int> positions;
+};
+///
 /// Data struct holds a review and its score
 ///
 struct data
@@ -110,7 +166,108 @@ struct data
     }
 };
 ///
-/// save `data`'s review vectors to a file
+/// a contiguous range of words, e.g. a review's words
+///
+struct word_range
+{
+    word_range(const word * first, const word * last)
+    : first(first), last(last)
+    {}
+
+    word_range(const std::vector<word> & words)
+    : first(words.data()), last(words.data() + words.size())
+    {}
+
+    inline const word * begin() const
+    {
+        return first;
+    }
+
+    inline const word * end() const
+    {
+        return last;
+    }
+
+    inline std::size_t size() const
+    {
+        return last - first;
+    }
+
+    inline bool empty() const
+    {
+        return first == last;
+    }
+
+    const word * first;
+    const word * last;
+};
+///
+/// reference to the shared row `row` of a `row_table`, placed at column `position`
+///
+struct row_ref
+{
+    unsigned int position;
+    unsigned int row;
+};
+///
+/// dictionary-encoded review matrix: a review's vector is a concatenation
+/// of per-word rows, so each distinct row is stored once and reviews only
+/// reference it - positions without a reference are all zero
+///
+struct row_table
+{
+    // values per word position (all principal keys)
+    unsigned int width = 0;
+    // columns (word positions) per review
+    unsigned int columns = 0;
+    // distinct per-word rows, each of `width` values
+    std::vector<thrust::host_vector<float>> rows;
+    // row references of each review, by ascending position (a position may repeat)
+    std::vector<std::vector<row_ref>> refs;
+
+    /// @return the amount of reviews
+    inline unsigned int size() const
+    {
+        return refs.size();
+    }
+
+    /// @return the shared row @param id
+    inline const thrust::host_vector<float> & row(unsigned int id) const
+    {
+        return rows.at(id);
+    }
+
+    /// @return the row references of review @param review
+    inline const std::vector<row_ref> & review(unsigned int review) const
+    {
+        return refs.at(review);
+    }
+
+    /// expand review @param review into its full (`width` * `columns`) vector
+    inline thrust::host_vector<float> expand(unsigned int review) const
+    {
+        thrust::host_vector<float> vector(width * columns);
+        // rows sharing a position (merged columns) keep their element-wise maximum
+        for (const row_ref & ref : refs.at(review))
+            for (unsigned int k = 0; k < width; k++)
+                vector[(ref.position * width) + k] = std::max(vector[(ref.position * width) + k],
+                                                              rows[ref.row][k]);
+        return vector;
+    }
+
+    /// expand all reviews into the vectors of @param dataset (in the same order)
+    inline void expand(std::vector<data> & dataset) const
+    {
+        if (dataset.size() != refs.size())
+            throw std::runtime_error("row_table: dataset size mismatch");
+
+        for (unsigned int i = 0; i < dataset.size(); i++)
+            dataset[i].vector = expand(i);
+    }
+};
+///
+/// save `data`'s review vectors to a text file - `save_container` writes a
+/// binary, memory-mappable file instead
 ///
 inline void save_vectorized(const std::vector<data> & arg, std::string filename)
 {
@@ -0,0 +1,143 @@
+#include "encoder.hpp"
+
+const unsigned int encoder::version;
+
+encoder encoder::fit(
+                      std::vector<data> & dataset,
+                      unsigned int f,
+                      unsigned int x,
+                      unsigned int y,
+                      unsigned int threads,
+                      const budget & limits,
+                      unsigned int depth
+                    )
+{
+    pipeline blob(dataset, f, x, y, threads, limits, depth);
+    return fit(blob, threads);
+}
+
+encoder encoder::fit(pipeline & blob, unsigned int threads)
+{
+    compressor & algo = blob.algo;
+    encoder result;
+    result.filter = blob.filter;
+    result.depth = blob.depth;
+    result.longest = blob.max_size;
+    result.enc_keys = algo.encodable();
+    result.non_enc_keys = algo.non_encodable();
+    result.columns = column_layout(result.longest);
+
+    // the rows of the encodable principals: all other principals are one-hot
+    unsigned int keys = result.enc_keys.size();
+    result.best_position.assign(keys, 0);
+    result.best_delta.assign(keys, 0.f);
+    result.dense_rows.assign(std::size_t(keys) * keys, 0.f);
+    algo.prepare_dense(threads);
+    parallel_for(keys, threads, [&](std::size_t i)
+    {
+        const word & key = result.enc_keys.words[i];
+        thrust::host_vector<float> sparse = algo.row(key, true);
+        for (unsigned int k = 0; k < keys; k++)
+        {
+            if (sparse[k] > 0.f)
+            {
+                result.best_position[i] = k;
+                result.best_delta[i] = sparse[k];
+            }
+        }
+        thrust::host_vector<float> dense = algo.row(key, false);
+        std::copy(dense.begin(), dense.begin() + keys, result.dense_rows.begin() + (i * keys));
+    });
+    return result;
+}
+
+void encoder::transform(std::vector<data> & dataset, bool sparse, unsigned int threads) const
+{
+    tokenizer tkr;
+    tkr.prefilter(dataset, filter);
+    tkr(dataset);
+    transform_tagged(dataset, sparse, threads);
+}
+
+void encoder::transform(corpus & arg, corpus::view & reviews, bool sparse, unsigned int threads) const
+{
+    tokenizer tkr;
+    reviews = tkr.prefilter(arg, reviews, filter);
+    tkr(arg, reviews);
+    parallel_for(reviews.size(), threads, [&](std::size_t k)
+    {
+        std::uint32_t i = reviews[k];
+        arg.vectors[i] = transform(arg.words_of(i), sparse);
+    });
+}
+
+void encoder::transform_tagged(std::vector<data> & dataset, bool sparse, unsigned int threads) const
+{
+    parallel_for(dataset.size(), threads, [&](std::size_t i)
+    {
+        dataset[i].vector = transform(dataset[i].words, sparse);
+    });
+}
+
+thrust::host_vector<float> encoder::transform(word_range words, bool sparse) const
+{
+    thrust::host_vector<float> VR(width());
+
+    // rows merged into one column keep their element-wise maximum, @see `column_layout`
+    visit(words, sparse, [&](std::size_t index, float value)
+    {
+        VR[index] = std::max(VR[index], value);
+    });
+    return VR;
+}
+
+void encoder::transform(
+                         word_range words,
+                         bool sparse,
+                         std::vector<std::uint32_t> & indices,
+                         std::vector<float> & values
+                       ) const
+{
+    std::vector<std::pair<std::uint32_t, float>> entries;
+    visit(words, sparse, [&](std::size_t index, float value)
+    {
+        entries.push_back(std::make_pair(std::uint32_t(index), value));
+    });
+    std::sort(entries.begin(), entries.end());
+
+    indices.clear();
+    values.clear();
+    for (const std::pair<std::uint32_t, float> & entry : entries)
+    {
+        // sorted by index then value: a repeated index ends at its maximum
+        if (!indices.empty() && indices.back() == entry.first)
+            values.back() = entry.second;
+        else
+        {
+            indices.push_back(entry.first);
+            values.push_back(entry.second);
+        }
+    }
+}
+
+void encoder::save(const std::string & filename) const
+{
+    std::ofstream file(filename, std::ios::binary);
+    if (!file)
+        throw std::runtime_error("couldn't write to file `"+filename+"`");
+
+    boost::archive::binary_oarchive archive(file);
+    archive << *this;
+}
+
+encoder encoder::load(const std::string & filename)
+{
+    std::ifstream file(filename, std::ios::binary);
+    if (!file)
+        throw std::runtime_error("couldn't read file: "+filename);
+
+    encoder result;
+    boost::archive::binary_iarchive archive(file);
+    archive >> result;
+    return result;
+}
@@ -0,0 +1,239 @@
+#ifndef NLP_ENCODER_ENCODER
+#define NLP_ENCODER_ENCODER
+#include "includes.ihh"
+///
+/// a fitted encoder: the principals, column layout and principal rows `compressor`
+/// derives from a training data-set. New reviews are then encoded by tagging and
+/// table lookups only - without WordNet, mining or principal selection.
+/// A word which isn't a principal is encoded as zero, as by `compressor`
+///
+class encoder
+{
+public:
+
+    /// file format version, @see `save` and `load`
+    static const unsigned int version = 2;
+
+    encoder() = default;
+
+    /// fit on @param dataset: POS tag it, drop reviews of @param f words or more,
+    /// then select the principals above @param x (encodable) and @param y (non-encodable)
+    /// within @param limits, expanding graphs up to @param depth layers (zero is unbounded)
+    /// - the same principals the compress calls select, @see `pipeline`
+    /// @warning: dataset will be tagged and filtered
+    static encoder fit(
+                        std::vector<data> & dataset,
+                        unsigned int f,
+                        unsigned int x,
+                        unsigned int y,
+                        unsigned int threads = 0,
+                        const budget & limits = budget(),
+                        unsigned int depth = 0
+                      );
+
+    /// fit on the principals @param blob selected
+    static encoder fit(pipeline & blob, unsigned int threads = 0);
+
+    /// POS tag @param dataset, drop reviews above the fitted filter and vectorize the rest
+    /// @warning: dataset will be tagged, filtered and modified
+    void transform(std::vector<data> & dataset, bool sparse, unsigned int threads = 0) const;
+
+    /// POS tag the @param reviews of @param arg, drop those above the fitted filter
+    /// from @param reviews and vectorize the rest into `corpus::vectors`
+    void transform(corpus & arg, corpus::view & reviews, bool sparse, unsigned int threads = 0) const;
+
+    /// vectorize an already tagged @param dataset, @see `transform`
+    void transform_tagged(std::vector<data> & dataset, bool sparse, unsigned int threads = 0) const;
+
+    /// vectorize the words of one review - the same vector `compressor` gives
+    thrust::host_vector<float> transform(word_range words, bool sparse) const;
+
+    /// vectorize the words of one review into its non-zero entries:
+    /// ascending @param indices of the `transform` vector and their @param values
+    /// @note words of `symbols::unknown` tokens are misses
+    void transform(
+                    word_range words,
+                    bool sparse,
+                    std::vector<std::uint32_t> & indices,
+                    std::vector<float> & values
+                  ) const;
+
+    /// size of the `transform` vectors
+    std::size_t width() const
+    {
+        return std::size_t(enc_keys.size() + non_enc_keys.size()) * columns.columns;
+    }
+
+    /// change the column layout of the following transforms (fitted: one column per position)
+    void reshape(const column_layout & layout)
+    {
+        columns = layout;
+    }
+
+    /// save to a binary file, versioned by `encoder::version`
+    void save(const std::string & filename) const;
+
+    /// load a file written by `save`
+    /// @throw if it can't be read or was written by a newer version
+    static encoder load(const std::string & filename);
+
+    /// encodable principal keys, by column
+    const vocabulary & encodable() const
+    {
+        return enc_keys;
+    }
+
+    /// non-encodable principal keys, by column (after the encodable keys)
+    const vocabulary & non_encodable() const
+    {
+        return non_enc_keys;
+    }
+
+    /// column layout of the vectors
+    const column_layout & layout() const
+    {
+        return columns;
+    }
+
+    /// longest fitted review
+    unsigned int max_size() const
+    {
+        return longest;
+    }
+
+    /// fitted hypernym/hyponym expansion depth (zero is unbounded)
+    unsigned int max_depth() const
+    {
+        return depth;
+    }
+
+private:
+
+    friend class boost::serialization::access;
+
+    /// call @param place(index, value) for every value the rows of @param words set,
+    /// an index may be set more than once (merged columns keep the maximum)
+    template <class F> void visit(word_range words, bool sparse, F && place) const;
+
+    template <class Archive> void save(Archive & ar, const unsigned int) const;
+    template <class Archive> void load(Archive & ar, const unsigned int file_version);
+    BOOST_SERIALIZATION_SPLIT_MEMBER()
+
+    /// reviews of `filter` words or more are dropped
+    unsigned int filter = 0;
+    /// longest fitted review
+    unsigned int longest = 0;
+    /// expansion depth the principal rows were fitted with
+    unsigned int depth = 0;
+    /// principal keys
+    vocabulary enc_keys;
+    vocabulary non_enc_keys;
+    /// review columns
+    column_layout columns = column_layout(0);
+    /// best (sparse) match of each encodable principal: its position and delta
+    std::vector<unsigned int> best_position;
+    std::vector<float> best_delta;
+    /// dense (all delta) rows of the encodable principals, back to back
+    std::vector<float> dense_rows;
+};
+
+template <class F>
+void encoder::visit(word_range words, bool sparse, F && place) const
+{
+    unsigned int encodable = enc_keys.size();
+    unsigned int keys = encodable + non_enc_keys.size();
+    unsigned int i = 0;
+
+    for (const word & key : words)
+    {
+        int column = columns.column(i++);
+        if (column < 0)
+            continue;
+
+        // a token never interned can't be a principal
+        if (key.token_id == symbols::unknown)
+            continue;
+
+        std::size_t begin = std::size_t(column) * keys;
+        int position = enc_keys.find(key);
+        if (position >= 0 && sparse)
+        {
+            if (best_delta[position] > 0.f)
+                place(begin + best_position[position], best_delta[position]);
+        }
+        else if (position >= 0)
+        {
+            for (unsigned int k = 0; k < encodable; k++)
+                if (dense_rows[std::size_t(position) * encodable + k] > 0.f)
+                    place(begin + k, dense_rows[std::size_t(position) * encodable + k]);
+        }
+        else if ((position = non_enc_keys.find(key)) >= 0)
+            place(begin + encodable + position, 1.f);
+    }
+}
+
+template <class Archive>
+void encoder::save(Archive & ar, const unsigned int) const
+{
+    std::vector<std::string> tokens, tags;
+    for (const vocabulary * keys : {&enc_keys, &non_enc_keys})
+        for (const word & key : keys->words)
+        {
+            tokens.push_back(key.token());
+            tags.push_back(key.tag());
+        }
+    unsigned int encodable = enc_keys.size();
+
+    ar & filter & longest & encodable & tokens & tags
+       & columns.columns & columns.exact
+       & best_position & best_delta & dense_rows
+       & depth;
+}
+
+template <class Archive>
+void encoder::load(Archive & ar, const unsigned int file_version)
+{
+    if (file_version > version)
+        throw std::runtime_error("encoder file version "+std::to_string(file_version)
+                                 +" is newer than "+std::to_string(version));
+
+    std::vector<std::string> tokens, tags;
+    unsigned int encodable;
+    ar & filter & longest & encodable & tokens & tags
+       & columns.columns & columns.exact
+       & best_position & best_delta & dense_rows;
+    // version 1 files were always fitted with unbounded graphs
+    depth = 0;
+    if (file_version > 1)
+        ar & depth;
+
+    if (tokens.size() != tags.size() || encodable > tokens.size()
+        || best_position.size() != encodable || best_delta.size() != encodable
+        || dense_rows.size() != std::size_t(encodable) * encodable
+        || columns.exact > columns.columns)
+        throw std::runtime_error("corrupt encoder file");
+
+    for (unsigned int position : best_position)
+        if (position >= encodable)
+            throw std::runtime_error("corrupt encoder file");
+
+    // both vocabularies were saved in column order, which they rebuild
+    std::unordered_set<word> enc, non_enc;
+    for (unsigned int i = 0; i < tokens.size(); i++)
+        (i < encodable ? enc : non_enc).insert(word(tokens[i], tags[i]));
+    enc_keys = vocabulary(enc);
+    non_enc_keys = vocabulary(non_enc);
+
+    // duplicate or reordered keys would misalign the rows and columns
+    for (unsigned int i = 0; i < tokens.size(); i++)
+    {
+        const vocabulary & keys = i < encodable ? enc_keys : non_enc_keys;
+        unsigned int position = i < encodable ? i : i - encodable;
+        if (position >= keys.size() || !(keys.words[position] == word(tokens[i], tags[i]))
+            || (i < encodable && non_enc_keys.find(keys.words[position]) >= 0))
+            throw std::runtime_error("corrupt encoder file");
+    }
+}
+
+BOOST_CLASS_VERSION(encoder, encoder::version)
+#endif
@@ -0,0 +1,83 @@
+#ifndef NLP_ENCODER_HISTOGRAM
+#define NLP_ENCODER_HISTOGRAM
+#include "includes.ihh"
+///
+/// log-linear histogram of non-negative integer samples (e.g. latencies in microseconds):
+/// each power of two is split into `steps` buckets, so a percentile is reported
+/// as its bucket's upper bound - at most 1/`steps` (12.5%) above the true sample
+///
+struct histogram
+{
+    /// buckets per power of two
+    static const unsigned int steps = 8;
+
+    histogram()
+    : buckets(64 * steps, 0)
+    {}
+
+    /// record one @param sample
+    void record(std::uint64_t sample)
+    {
+        buckets[bucket(sample)]++;
+        count++;
+        largest = std::max(largest, sample);
+    }
+
+    /// @return the upper bound of the @param p (0, 1] percentile, zero without samples
+    std::uint64_t percentile(double p) const
+    {
+        if (count == 0)
+            return 0;
+
+        std::uint64_t rank = std::max<std::uint64_t>(1, std::uint64_t(p * count + 0.5));
+        std::uint64_t seen = 0;
+        for (unsigned int b = 0; b < buckets.size(); b++)
+        {
+            seen += buckets[b];
+            if (seen >= rank)
+                return std::min(largest, upper(b));
+        }
+        return largest;
+    }
+
+    /// forget all samples
+    void reset()
+    {
+        std::fill(buckets.begin(), buckets.end(), 0);
+        count = 0;
+        largest = 0;
+    }
+
+    // amount of samples
+    std::uint64_t count = 0;
+    // largest sample
+    std::uint64_t largest = 0;
+
+private:
+
+    /// samples below `steps` have a bucket each, then `steps` buckets per power of two
+    static unsigned int bucket(std::uint64_t sample)
+    {
+        if (sample < steps)
+            return sample;
+
+        unsigned int power = 63 - __builtin_clzll(sample);
+        unsigned int step = (sample >> (power - 3)) & (steps - 1);
+        return (power - 2) * steps + step;
+    }
+
+    /// largest sample of bucket @param b
+    static std::uint64_t upper(unsigned int b)
+    {
+        if (b < steps)
+            return b;
+
+        unsigned int power = b / steps + 2;
+        std::uint64_t step = b % steps;
+        return ((steps + step + 1) << (power - 3)) - 1;
+    }
+
+    // samples per bucket
+    std::vector<std::uint64_t> buckets;
+};
+#endif
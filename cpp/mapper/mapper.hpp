@@ -2,38 +2,97 @@
 #define NLP_ENCODER_MAPPER
 #include "includes.ihh"
 ///
+/// Penn Treebank POS tags - `none` is the empty tag
+/// @see https://www.ling.upenn.edu/courses/Fall_2003/ling001/penn_treebank_pos.html
+///
+enum class penn : std::uint8_t
+{
+    none,
+    CC, CD, DT, EX, FW, IN, JJ, JJR, JJS, LS, MD, NN, NNS, NNP, NNPS,
+    PDT, POS, PRP, PRPS, RB, RBR, RBS, RP, SYM, TO, UH,
+    VB, VBD, VBG, VBN, VBP, VBZ, WDT, WP, WPS, WRB,
+    HASH, DOLLAR, QUOTE_CLOSE, QUOTE_OPEN, COMMA, LRB, RRB, PERIOD, COLON,
+    count
+};
+
+/// amount of Penn tags (including `none`)
+constexpr unsigned int penn_count = static_cast<unsigned int>(penn::count);
+
+/// tag names, by `penn` value
+constexpr const char * penn_names[penn_count] =
+{
+    "",
+    "CC", "CD", "DT", "EX", "FW", "IN", "JJ", "JJR", "JJS", "LS", "MD", "NN", "NNS", "NNP", "NNPS",
+    "PDT", "POS", "PRP", "PRP$", "RB", "RBR", "RBS", "RP", "SYM", "TO", "UH",
+    "VB", "VBD", "VBG", "VBN", "VBP", "VBZ", "WDT", "WP", "WP$", "WRB",
+    "#", "$", "''", "``", ",", "-LRB-", "-RRB-", ".", ":"
+};
+
+/// WordNet lexical of the tags which start with: N (1 NOUN), V (2 VERB), J (3 ADJECTIVE)
+/// and R (4 ADVERB) - but `RP` is a particle. -1 for all others: WordNet doesn't have them
+constexpr int lexical_of(const char * name)
+{
+    return name[0] == 'N' ? 1
+         : name[0] == 'V' ? 2
+         : name[0] == 'J' ? 3
+         : (name[0] == 'R' && !(name[1] == 'P' && name[2] == '\0')) ? 4
+         : -1;
+}
+
+/// WordNet lexical, by `penn` value
+constexpr int penn_lexicals[penn_count] =
+{
+    -1,
+    -1, -1, -1, -1, -1, -1,  3,  3,  3, -1, -1,  1,  1,  1,  1,
+    -1, -1, -1, -1,  4,  4,  4, -1, -1, -1, -1,
+     2,  2,  2,  2,  2,  2, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1
+};
+
+/// check `penn_lexicals` against `lexical_of` from entry @param i on
+constexpr bool lexicals_match(unsigned int i = 0)
+{
+    return i == penn_count
+           || (penn_lexicals[i] == lexical_of(penn_names[i]) && lexicals_match(i + 1));
+}
+static_assert(lexicals_match(), "`penn_lexicals` doesn't match the tag names");
+
+/// @return the `penn` tag named @param name, `penn::count` if it isn't a Penn tag
+inline penn penn_of(const std::string & name)
+{
+    for (unsigned int i = 0; i < penn_count; i++)
+        if (name == penn_names[i])
+            return static_cast<penn>(i);
+    return penn::count;
+}
+///
 /// map pos tags to wordnet params (lexical)
 /// it maps Peen Treebank POS tags
-/// @see https://www.ling.upenn.edu/courses/Fall_2003/ling001/penn_treebank_pos.html
 /// @see WordNet-3.0/includes/wn.h
 ///
 struct mapper
 {
+    // return -1 if pos tag can't be used: a single table lookup
+    // tags past the Penn tags (e.g. interned non-Penn tags) can't be used
+    inline int operator()(penn pos) const
+    {
+        unsigned int i = static_cast<unsigned int>(pos);
+        return i < penn_count ? penn_lexicals[i] : -1;
+    }
+
     // return -1 if pos tag can't be used
-    inline int operator()(const std::string pos)
+    inline int operator()(const std::string & pos) const
     {
         if (pos.empty())
             throw std::runtime_error("empty @param pos");
 
-        // if it starts with N its a NOUN
-        if (pos[0] == 'N')
-            return 1;
-
-        // if it starts with a V its a VERB
-        else if (pos[0] == 'V')
-            return 2;
-
-        // if it starts with a J its an ADJECTIVE
-        else if (pos[0] == 'J')
-            return 3;
-
-        // if it starts with an R its an ADVERB - NOTE `RP` is Particle!
-        else if (pos[0] == 'R')
-            if (pos.compare("RP") != 0)
-                return 4;
-                
-        // ignore all other PENN pos tags - WordNet doesn't have them
-        return -1;
+        return (*this)(penn_of(pos));
+    }
+
+    // open-class (content) words: nouns, verbs, adjectives and adverbs
+    inline bool open_class(penn pos) const
+    {
+        return (*this)(pos) > 0;
     }
 };
 #endif
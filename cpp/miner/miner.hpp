@@ -2,12 +2,261 @@
 #define NLP_ENCODER_MINER
 #include "includes.ihh"
 ///
+/// Space-Saving heavy hitters (Metwally et al.) over at most `capacity` words, in bounded memory.
+/// After counting N words:
+///  - every kept count overestimates its word's frequency by at most its `error` <= N / capacity
+///  - every word more frequent than N / capacity is kept
+/// Sketches (e.g. one per thread) merge into a sketch with the same bounds over the sum of N
+///
+class sketch
+{
+public:
+
+    explicit sketch(unsigned int capacity)
+    : capacity(capacity)
+    {
+        if (capacity == 0)
+            throw std::runtime_error("sketch capacity must be positive");
+    }
+
+    /// count @param key @param count times
+    void add(const word & key, unsigned int count = 1)
+    {
+        total += count;
+        auto it = positions.find(key);
+        if (it != positions.end())
+        {
+            counters[it->second].count += count;
+            sift_down(it->second);
+        }
+        else if (counters.size() < capacity)
+        {
+            positions[key] = counters.size();
+            counters.push_back({key, count, 0});
+            sift_up(counters.size() - 1);
+        }
+        // replace the least counted word, inheriting its count as error
+        else
+        {
+            counter & least = counters[0];
+            positions.erase(least.key);
+            least.error = least.count;
+            least.count += count;
+            least.key = key;
+            positions[key] = 0;
+            sift_down(0);
+        }
+    }
+
+    /// merge @param rhs into this sketch: a word missing from one side may have
+    /// been counted up to that side's minimum, which is added to its count and error
+    void merge(const sketch & rhs)
+    {
+        // each side adds at most its N / capacity (its own error, or its minimum
+        // when the word is missing), so the summed error stays <= N / capacity
+        unsigned int lhs_min = minimum(), rhs_min = rhs.minimum();
+        std::unordered_map<word, counter> merged;
+        for (const counter & item : counters)
+        {
+            auto it = rhs.positions.find(item.key);
+            unsigned int count = it != rhs.positions.end() ? rhs.counters[it->second].count : rhs_min;
+            unsigned int error = it != rhs.positions.end() ? rhs.counters[it->second].error : rhs_min;
+            merged[item.key] = {item.key, item.count + count, item.error + error};
+        }
+
+        for (const counter & item : rhs.counters)
+            if (positions.find(item.key) == positions.end())
+                merged[item.key] = {item.key, item.count + lhs_min, item.error + lhs_min};
+
+        // keep the `capacity` largest counts
+        std::vector<counter> kept;
+        for (auto & item : merged)
+            kept.push_back(item.second);
+        if (kept.size() > capacity)
+        {
+            std::nth_element(kept.begin(), kept.begin() + capacity, kept.end(),
+                             [](const counter & lhs, const counter & rhs)
+                             { return lhs.count > rhs.count; });
+            kept.resize(capacity);
+        }
+
+        total += rhs.total;
+        counters.clear();
+        positions.clear();
+        for (const counter & item : kept)
+        {
+            positions[item.key] = counters.size();
+            counters.push_back(item);
+            sift_up(counters.size() - 1);
+        }
+    }
+
+    /// @return the estimated frequencies of the kept words (never below the true ones)
+    std::unordered_map<word, unsigned int> frequencies() const
+    {
+        std::unordered_map<word, unsigned int> result;
+        for (const counter & item : counters)
+            result[item.key] = item.count;
+        return result;
+    }
+
+    /// @return the most a kept count of @param key overestimates, or the largest
+    ///         frequency @param key may have if it isn't kept
+    unsigned int error(const word & key) const
+    {
+        auto it = positions.find(key);
+        return it != positions.end() ? counters[it->second].error : minimum();
+    }
+
+    /// @return the amount of words counted
+    unsigned long long size() const
+    {
+        return total;
+    }
+
+private:
+
+    struct counter
+    {
+        word key;
+        unsigned int count;
+        unsigned int error;
+    };
+
+    /// smallest kept count if full (an unkept word can't be more frequent), else zero
+    unsigned int minimum() const
+    {
+        return counters.size() < capacity ? 0 : counters[0].count;
+    }
+
+    void swap(std::size_t lhs, std::size_t rhs)
+    {
+        std::swap(counters[lhs], counters[rhs]);
+        positions[counters[lhs].key] = lhs;
+        positions[counters[rhs].key] = rhs;
+    }
+
+    void sift_up(std::size_t i)
+    {
+        while (i > 0 && counters[(i - 1) / 2].count > counters[i].count)
+        {
+            swap(i, (i - 1) / 2);
+            i = (i - 1) / 2;
+        }
+    }
+
+    void sift_down(std::size_t i)
+    {
+        for (;;)
+        {
+            std::size_t least = i, left = 2 * i + 1, right = 2 * i + 2;
+            if (left < counters.size() && counters[left].count < counters[least].count)
+                least = left;
+            if (right < counters.size() && counters[right].count < counters[least].count)
+                least = right;
+            if (least == i)
+                return;
+            swap(i, least);
+            i = least;
+        }
+    }
+
+    const unsigned int capacity;
+    unsigned long long total = 0;
+    // min-heap of counters, by count
+    std::vector<counter> counters;
+    // heap position of each kept word
+    std::unordered_map<word, std::size_t> positions;
+};
+///
 /// mine a data-set for all word frequencies 
 /// note: there is no point in mining `unknown` words (unavailable from wordnet)
 ///       thus we only mine `known` words - words for which we have semantic relations
 ///
 struct miner
 {
+    /// count the frequency of every word (token/tag) in the data-set, in one pass
+    std::unordered_map<word, unsigned int> frequencies(const std::vector<data> & dataset)
+    {
+        std::unordered_map<word, unsigned int> result;
+        for (const data & review : dataset)
+            for (const word & key : review.words)
+                result[key]++;
+
+        return result;
+    }
+
+    /// count the frequency of every word of the @param reviews of @param arg, in one pass
+    std::unordered_map<word, unsigned int> frequencies(const corpus & arg, const corpus::view & reviews)
+    {
+        std::unordered_map<word, unsigned int> result;
+        for (std::uint32_t i : reviews.indices)
+            for (const word & key : arg.words_of(i))
+                result[key]++;
+
+        return result;
+    }
+
+    /// estimate word frequencies with a @param capacity words sketch per thread (0 is all cores),
+    /// merged at the end - @see `sketch` for the error bounds
+    sketch approximate(const std::vector<data> & dataset, unsigned int capacity, unsigned int threads = 0)
+    {
+        unsigned int count = std::max<std::size_t>(1, std::min<std::size_t>(workers(threads), dataset.size()));
+        std::vector<sketch> partial(count, sketch(capacity));
+        parallel_for(count, count, [&](std::size_t t)
+        {
+            std::size_t begin = dataset.size() * t / count;
+            std::size_t end = dataset.size() * (t + 1) / count;
+            for (std::size_t i = begin; i < end; i++)
+                for (const word & key : dataset[i].words)
+                    partial[t].add(key);
+        });
+
+        for (std::size_t t = 1; t < count; t++)
+            partial[0].merge(partial[t]);
+        return partial[0];
+    }
+
+    /// estimate the word frequencies of the @param reviews of @param arg, as `approximate`
+    sketch approximate(
+                        const corpus & arg,
+                        const corpus::view & reviews,
+                        unsigned int capacity,
+                        unsigned int threads = 0
+                      )
+    {
+        unsigned int count = std::max<std::size_t>(1, std::min<std::size_t>(workers(threads), reviews.size()));
+        std::vector<sketch> partial(count, sketch(capacity));
+        parallel_for(count, count, [&](std::size_t t)
+        {
+            std::size_t begin = reviews.size() * t / count;
+            std::size_t end = reviews.size() * (t + 1) / count;
+            for (std::size_t k = begin; k < end; k++)
+                for (const word & key : arg.words_of(reviews[k]))
+                    partial[t].add(key);
+        });
+
+        for (std::size_t t = 1; t < count; t++)
+            partial[0].merge(partial[t]);
+        return partial[0];
+    }
+
+    /// get the word stats of `words` from pre-counted @param frequencies
+    std::vector<triplet> operator()(
+                                    const std::unordered_map<word, unsigned int> & frequencies,
+                                    const std::unordered_set<word> & words
+                                   )
+    {
+        std::vector<triplet> result;
+        for (const word & key : words)
+        {
+            auto it = frequencies.find(key);
+            if (it != frequencies.end())
+                result.push_back({key, it->second});
+        }
+        return result;
+    }
+
     /// mine the data-set for word stats
     std::vector<triplet> operator()(
                                     const std::vector<data> & dataset,
@@ -30,15 +279,14 @@ struct miner
                     // search to see if word already exists in `result`
                     auto it = std::find_if(result.begin(), result.end(),
                                            [&](const triplet & rhs)
-                                           { return rhs.token == lhs.token 
-                                                    && rhs.tag == lhs.tag; });
+                                           { return rhs.key == lhs; });
                     // if yes, increment frequency
                     if (it != result.end())
                         it->freq++;
 
                     // if not, insert a new tuple
                     else
-                        result.push_back({lhs.token, lhs.tag, 1});
+                        result.push_back({lhs, 1});
                 }
             } 
         }
@@ -49,15 +297,15 @@ struct miner
 ///
 /// save the word stats in a text friendly way on disk
 ///
-void save_stats(const std::vector<triplet> & rhs)
+inline void save_stats(const std::vector<triplet> & rhs)
 {
     std::ofstream file;
     file.open("word_stats.data");
     if(file.is_open())
     {
         for (const triplet & tpl : rhs)
-            file << tpl.token << "\t" 
-                 << tpl.tag << "\t" 
+            file << tpl.key.token() << "\t" 
+                 << tpl.key.tag() << "\t" 
                  << tpl.freq << "\r\n";
         file.close();
     }
@@ -0,0 +1,59 @@
+#ifndef NLP_ENCODER_PARALLEL
+#define NLP_ENCODER_PARALLEL
+#include "includes.ihh"
+///
+/// number of worker threads to use: @param threads, or all cores if zero
+///
+inline unsigned int workers(unsigned int threads)
+{
+    if (threads == 0)
+        threads = std::thread::hardware_concurrency();
+    return threads > 0 ? threads : 1;
+}
+///
+/// call @param work for each index in [0, @param count) on up to @param threads threads
+/// indices are split into contiguous ranges, one per thread
+/// the first exception thrown by `work` is re-thrown once all threads have joined
+///
+template <typename F>
+void parallel_for(std::size_t count, unsigned int threads, F && work)
+{
+    threads = std::min<std::size_t>(workers(threads), count);
+    if (threads <= 1)
+    {
+        for (std::size_t i = 0; i < count; i++)
+            work(i);
+        return;
+    }
+
+    std::exception_ptr error = nullptr;
+    std::mutex error_mutex;
+    std::vector<std::thread> pool;
+    std::size_t range = (count + threads - 1) / threads;
+
+    for (unsigned int t = 0; t < threads; t++)
+    {
+        std::size_t begin = t * range;
+        std::size_t end = std::min(count, begin + range);
+        pool.emplace_back([&, begin, end]
+        {
+            try
+            {
+                for (std::size_t i = begin; i < end; i++)
+                    work(i);
+            }
+            catch (...)
+            {
+                std::lock_guard<std::mutex> lock(error_mutex);
+                if (!error)
+                    error = std::current_exception();
+            }
+        });
+    }
+    for (std::thread & thread : pool)
+        thread.join();
+
+    if (error)
+        std::rethrow_exception(error);
+}
+#endif
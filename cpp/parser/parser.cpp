@@ -33,3 +33,74 @@ std::vector<data> parser::operator()(std::string filename)
     return dataset;
 }
 
+
+/// call @param emit(first, last, score) for each non-empty line of @param text
+template <class F>
+static void for_each_line(
+                           const char * text,
+                           std::size_t length,
+                           const float * scores,
+                           std::size_t count,
+                           F && emit
+                         )
+{
+    const char * end = text + length;
+    // count the lines first: scores must match them
+    std::size_t total = 0;
+    for (const char * it = text; it < end; total++)
+    {
+        const char * eol = static_cast<const char*>(std::memchr(it, '\n', end - it));
+        it = eol ? eol + 1 : end;
+    }
+    if (scores && count != total)
+        throw std::runtime_error("got "+std::to_string(count)+" scores for "
+                                 +std::to_string(total)+" lines");
+
+    std::size_t i = 0;
+    for (const char * it = text; it < end; i++)
+    {
+        const char * eol = static_cast<const char*>(std::memchr(it, '\n', end - it));
+        const char * next = eol ? eol + 1 : end;
+        if (!eol)
+            eol = end;
+        if (eol > it && eol[-1] == '\r')
+            eol--;
+
+        if (eol > it)
+            emit(it, eol, scores ? scores[i] : 0.f);
+        it = next;
+    }
+}
+
+std::vector<data> parser::lines(
+                                 const char * text,
+                                 std::size_t length,
+                                 const float * scores,
+                                 std::size_t count
+                               )
+{
+    std::vector<data> dataset;
+    for_each_line(text, length, scores, count, [&](const char * first, const char * last, float score)
+    {
+        dataset.emplace_back();
+        dataset.back().review.assign(first, last);
+        dataset.back().score = score;
+    });
+    return dataset;
+}
+
+void parser::lines(
+                    const char * text,
+                    std::size_t length,
+                    corpus & out,
+                    const float * scores,
+                    std::size_t count
+                  )
+{
+    // the arena never holds more than the text
+    out.text.reserve(out.text.size() + length);
+    for_each_line(text, length, scores, count, [&](const char * first, const char * last, float score)
+    {
+        out.push_back(first, last, score);
+    });
+}
@@ -8,5 +8,24 @@ struct parser
 {
     // load a file into a vector of data
     std::vector<data> operator()(std::string filename);
+
+    // split newline-delimited UTF-8 @param text into reviews, in one pass over the bytes.
+    // line `i` is scored @param scores[i] (0 without scores) - a trailing newline ends
+    // the last line, `\r\n` endings are accepted and empty lines are skipped
+    std::vector<data> lines(
+                             const char * text,
+                             std::size_t length,
+                             const float * scores = nullptr,
+                             std::size_t count = 0
+                           );
+
+    // split @param text into the reviews of @param out, as `lines`, without a row per review
+    void lines(
+                const char * text,
+                std::size_t length,
+                corpus & out,
+                const float * scores = nullptr,
+                std::size_t count = 0
+              );
 };
 #endif
@@ -0,0 +1,121 @@
+#ifndef NLP_ENCODER_PIPELINE
+#define NLP_ENCODER_PIPELINE
+#include "includes.ihh"
+///
+/// most principals of each kind, zero is unlimited,
+/// and the capacity of the approximate frequency sketch, zero counts exactly
+///
+struct budget
+{
+    unsigned int encodable = 0;
+    unsigned int non_encodable = 0;
+    unsigned int approximate = 0;
+};
+///
+/// tag, filter, mine and select the principals of a data-set: the one path
+/// every compress call and `encoder::fit` take from reviews to a `compressor`
+///
+struct pipeline
+{
+    /// drop the reviews of @param dataset with @param f words or more, POS tag the rest,
+    /// then select the principals above @param x (encodable) and @param y (non-encodable)
+    /// within @param limits, expanding graphs up to @param depth layers (zero is unbounded)
+    /// @warning: dataset will be tagged and filtered
+    pipeline(
+              std::vector<data> & dataset,
+              unsigned int f,
+              unsigned int x,
+              unsigned int y,
+              unsigned int threads,
+              const budget & limits = budget(),
+              unsigned int depth = 0
+            )
+    : pipeline(mine(dataset, f, threads, limits), f, x, y, threads, limits, depth)
+    {}
+
+    /// as above, over the @param selected reviews of @param reviews - left filtered
+    pipeline(
+              corpus & reviews,
+              corpus::view & selected,
+              unsigned int f,
+              unsigned int x,
+              unsigned int y,
+              unsigned int threads,
+              const budget & limits = budget(),
+              unsigned int depth = 0
+            )
+    : pipeline(mine(reviews, selected, f, threads, limits), f, x, y, threads, limits, depth)
+    {}
+
+    /// No Copying allowed: `algo` refers to `sema_blob`
+    pipeline(const pipeline &) = delete;
+
+    // No assignment Allowed
+    pipeline& operator=(const pipeline &) = delete;
+
+    // reviews of `filter` words or more are dropped
+    unsigned int filter;
+    // longest review after filtering
+    unsigned int max_size;
+    // hypernym/hyponym expansion depth (zero is unbounded)
+    unsigned int depth;
+    std::unordered_map<word, unsigned int> frequencies;
+    semantics sema_blob;
+    compressor algo;
+
+private:
+
+    /// the longest review and the word frequencies of a tagged data-set
+    typedef std::pair<unsigned int, std::unordered_map<word, unsigned int>> mined;
+
+    pipeline(
+              mined && stats,
+              unsigned int f,
+              unsigned int x,
+              unsigned int y,
+              unsigned int threads,
+              const budget & limits,
+              unsigned int depth
+            )
+    : filter(f),
+      max_size(stats.first),
+      depth(depth),
+      frequencies(std::move(stats.second)),
+      // word frequencies come first: only words which may become principals are resolved
+      sema_blob(frequencies, std::min(x, y), depth, threads),
+      algo(sema_blob,
+           principals()(miner()(frequencies, sema_blob.known_words), x, limits.encodable),
+           principals()(miner()(frequencies, sema_blob.unknown_words), y, limits.non_encodable))
+    {}
+
+    /// filter reviews above length @param f, POS tag the rest, then count their words
+    static mined mine(std::vector<data> & dataset, unsigned int f, unsigned int threads, const budget & limits)
+    {
+        tokenizer tkr;
+        // count tokens before tagging: excluded reviews are never tagged
+        tkr.prefilter(dataset, f);
+        tkr(dataset);
+        return mined(tkr.max_size(dataset),
+                     limits.approximate > 0
+                     ? miner().approximate(dataset, limits.approximate, threads).frequencies()
+                     : miner().frequencies(dataset));
+    }
+
+    static mined mine(
+                       corpus & reviews,
+                       corpus::view & selected,
+                       unsigned int f,
+                       unsigned int threads,
+                       const budget & limits
+                     )
+    {
+        tokenizer tkr;
+        selected = tkr.prefilter(reviews, selected, f);
+        tkr(reviews, selected);
+        return mined(reviews.max_size(selected),
+                     limits.approximate > 0
+                     ? miner().approximate(reviews, selected, limits.approximate, threads).frequencies()
+                     : miner().frequencies(reviews, selected));
+    }
+};
+#endif
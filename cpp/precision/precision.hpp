@@ -0,0 +1,166 @@
+#ifndef NLP_ENCODER_PRECISION
+#define NLP_ENCODER_PRECISION
+#include "includes.ihh"
+///
+/// value types of stored or exported vectors: vectors are computed as floats,
+/// then narrowed once on output. Deltas lie in [0, 1] and binary entries are
+/// exactly 0 or 1, so `uint8` (a fixed 1/255 scale) loses at most 1/510 per value
+///
+enum class dtype : std::uint32_t
+{
+    float32 = 0,
+    float16 = 1, // IEEE 754 half, round to nearest even
+    uint8 = 2    // round(value * 255), clamped to [0, 1]
+};
+
+/// @return the bytes per value of @param type
+inline std::size_t size_of(dtype type)
+{
+    switch (type)
+    {
+        case dtype::float32: return 4;
+        case dtype::float16: return 2;
+        case dtype::uint8:   return 1;
+    }
+    throw std::runtime_error("unknown dtype");
+}
+
+/// @return the value type named @param name: `float32`, `float16` or `uint8`
+inline dtype dtype_of(const std::string & name)
+{
+    if (name == "float32") return dtype::float32;
+    if (name == "float16") return dtype::float16;
+    if (name == "uint8")   return dtype::uint8;
+    throw std::runtime_error("unknown dtype `"+name+"`");
+}
+
+/// @return the name of @param type, @see `dtype_of`
+inline const char * dtype_name(dtype type)
+{
+    switch (type)
+    {
+        case dtype::float32: return "float32";
+        case dtype::float16: return "float16";
+        case dtype::uint8:   return "uint8";
+    }
+    throw std::runtime_error("unknown dtype");
+}
+
+/// @return the half bits of @param value
+inline std::uint16_t to_half(float value)
+{
+    std::uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    std::uint32_t sign = (bits >> 16) & 0x8000;
+    std::uint32_t abs = bits & 0x7fffffff;
+
+    // infinity and NaN (kept quiet), then overflow
+    if (abs >= 0x7f800000)
+        return sign | 0x7c00 | (abs > 0x7f800000 ? 0x200 : 0);
+    if (abs >= 0x47800000)
+        return sign | 0x7c00;
+
+    std::uint32_t half, rest, midpoint;
+    if (abs >= 0x38800000)
+    {
+        // normal: re-bias the exponent, drop 13 mantissa bits
+        half = (abs >> 13) - (112 << 10);
+        rest = abs & 0x1fff;
+        midpoint = 0x1000;
+    }
+    else
+    {
+        // subnormal (or zero): the implicit bit shifts into the mantissa
+        if (abs < 0x33000000)
+            return sign;
+        std::uint32_t shift = 126 - (abs >> 23);
+        std::uint32_t mantissa = (abs & 0x7fffff) | 0x800000;
+        half = mantissa >> shift;
+        rest = mantissa & ((1u << shift) - 1);
+        midpoint = 1u << (shift - 1);
+    }
+    // a carry out of the mantissa correctly bumps the exponent (or reaches infinity)
+    if (rest > midpoint || (rest == midpoint && (half & 1)))
+        half++;
+    return sign | half;
+}
+
+/// @return the float of the half bits @param half
+inline float from_half(std::uint16_t half)
+{
+    std::uint32_t sign = std::uint32_t(half & 0x8000) << 16;
+    std::uint32_t exponent = (half >> 10) & 0x1f;
+    std::uint32_t mantissa = half & 0x3ff;
+    if (exponent == 0)
+    {
+        float value = std::ldexp(float(mantissa), -24);
+        return sign ? -value : value;
+    }
+
+    std::uint32_t bits = sign | (exponent == 31 ? 0x7f800000 : (exponent + 112) << 23) | (mantissa << 13);
+    float value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+/// @return @param value in [0, 1] as 1/255 steps
+inline std::uint8_t to_unorm8(float value)
+{
+    // NaN fails both comparisons and becomes zero
+    if (!(value > 0.f))
+        return 0;
+    if (value >= 1.f)
+        return 255;
+    return std::uint8_t(value * 255.f + 0.5f);
+}
+
+inline float from_unorm8(std::uint8_t value)
+{
+    return value / 255.f;
+}
+
+/// narrow @param count floats from @param in into @param out, `size_of(type)` bytes each
+inline void narrow(const float * in, std::size_t count, dtype type, void * out)
+{
+    switch (type)
+    {
+        case dtype::float32:
+            std::memcpy(out, in, count * sizeof(float));
+            break;
+        case dtype::float16:
+            for (std::size_t i = 0; i < count; i++)
+            {
+                std::uint16_t half = to_half(in[i]);
+                std::memcpy(static_cast<char*>(out) + i * 2, &half, 2);
+            }
+            break;
+        case dtype::uint8:
+            for (std::size_t i = 0; i < count; i++)
+                static_cast<std::uint8_t*>(out)[i] = to_unorm8(in[i]);
+            break;
+    }
+}
+
+/// @return value @param index of the `type` values at @param in, as a float
+inline float widen(const void * in, std::size_t index, dtype type)
+{
+    switch (type)
+    {
+        case dtype::float32:
+        {
+            float value;
+            std::memcpy(&value, static_cast<const char*>(in) + index * 4, 4);
+            return value;
+        }
+        case dtype::float16:
+        {
+            std::uint16_t half;
+            std::memcpy(&half, static_cast<const char*>(in) + index * 2, 2);
+            return from_half(half);
+        }
+        case dtype::uint8:
+            return from_unorm8(static_cast<const std::uint8_t*>(in)[index]);
+    }
+    throw std::runtime_error("unknown dtype");
+}
+#endif
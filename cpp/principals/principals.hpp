@@ -18,7 +18,50 @@ struct principals
         // filter based on frequency threshold
         for (const triplet & tpl : stats)
             if (tpl.freq > threshold)
-                result.insert({tpl.token, tpl.tag});
+                result.insert(tpl.key);
+
+        return result;
+    }
+
+    // filter words which appear more than `threshold` in corpus, keeping only
+    // the `budget` most frequent (all of them if `budget` is zero).
+    // ties are broken by token, then tag - the selection is deterministic
+    std::unordered_set<word> operator()(
+                                         const std::vector<triplet> & stats,
+                                         float threshold,
+                                         unsigned int budget
+                                       )
+    {
+        // candidates, with their strings fetched once for the tie breaks
+        struct ranked
+        {
+            unsigned int freq;
+            const std::string * token;
+            const std::string * tag;
+            word key;
+        };
+        std::vector<ranked> candidates;
+        for (const triplet & tpl : stats)
+            if (tpl.freq > threshold)
+                candidates.push_back({tpl.freq, &tpl.key.token(), &tpl.key.tag(), tpl.key});
+
+        if (budget > 0 && candidates.size() > budget)
+        {
+            std::nth_element(candidates.begin(), candidates.begin() + budget, candidates.end(),
+                             [](const ranked & lhs, const ranked & rhs)
+                             {
+                                 if (lhs.freq != rhs.freq)
+                                     return lhs.freq > rhs.freq;
+                                 if (lhs.key.token_id != rhs.key.token_id)
+                                     return *lhs.token < *rhs.token;
+                                 return *lhs.tag < *rhs.tag;
+                             });
+            candidates.resize(budget);
+        }
+
+        std::unordered_set<word> result;
+        for (const ranked & item : candidates)
+            result.insert(item.key);
 
         return result;
     }
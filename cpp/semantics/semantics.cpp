@@ -1,181 +1,368 @@
 #include "semantics.hpp"
 
-semantics::semantics(const std::vector<data> & dataset)
+/// WordNet relations followed by the hypernym and hyponym graphs
+static const std::vector<relation> up_pointers = {relation::hypernym, relation::instance_hypernym};
+static const std::vector<relation> down_pointers = {relation::hyponym, relation::instance_hyponym};
+
+constexpr float semantics::layer_step;
+constexpr float semantics::synonym_step;
+constexpr float semantics::min_step;
+
+semantics::semantics(const std::vector<data> & dataset, unsigned int max_depth, unsigned int threads)
+: store(wordnet::singleton()), max_depth(max_depth)
+{
+    // distinct words (token/tag) - the corpus is only scanned once
+    resolve(distinct_words(dataset, threads), threads);
+}
+
+semantics::semantics(
+                      const std::unordered_map<word, unsigned int> & frequencies,
+                      unsigned int threshold,
+                      unsigned int max_depth,
+                      unsigned int threads
+                    )
+: store(wordnet::singleton()), max_depth(max_depth)
+{
+    // only words frequent enough to become principals
+    std::vector<word> vocabulary;
+    for (const auto & item : frequencies)
+        if (item.second > threshold)
+            vocabulary.push_back(item.first);
+
+    resolve(vocabulary, threads);
+
+    // build their graphs now - each sense is only written by one thread
+    parallel_for(senses.size(), threads, [&](std::size_t i)
+    {
+        load(senses[i]);
+    });
+}
+
+void semantics::resolve(const std::vector<word> & vocabulary, unsigned int threads)
 {
-    // each data-set 
-    for (const data & review : dataset)
+    // resolve the lemma and first synset of each open-class word
+    // the pos is either: NOUN, VERB, ADJECTIVE or ADVERB (ignore other tags)
+    struct resolved
+    {
+        int pos;
+        std::string lemma;
+        std::int64_t synset;
+    };
+    std::vector<resolved> resolution(vocabulary.size());
+    parallel_for(vocabulary.size(), threads, [&](std::size_t i)
     {
-        // each triplet in each review
-        for (const word & key : review.words)
+        resolved & item = resolution[i];
+        item.pos = mapper()(vocabulary[i].pos());
+        item.synset = -1;
+        if (item.pos > 0)
         {
-            // for each triplet (word/pos tag)
-            // the pos is either: NOUN, VERB, ADJECTIVE or ADVERB (ignore other tags)
-            int pos = mapper()(key.tag);
-            if (pos > 0)
-            {
-                // not already in `known_words`: then look for it in WordNet
-                // check its not already in the `uknown_words`
-                auto known = known_words.find(key);
-                auto unknown = unknown_words.find(key);
-
-                // query if not in known and not in unknown
-                if (known == known_words.end() 
-                    && unknown == unknown_words.end())
-                {
-                    smnet::sense word_sense = smnet::query_all_senses(key.token, pos);
-
-                    // at least one of the graph-sets contains something
-                    if (word_sense.hypernyms.size() > 0 ||
-                        word_sense.hyponyms.size() > 0 ||
-                        word_sense.synonyms.size() > 0 )
-                    {
-                        known_words.insert(key);
-                        senses.push_back(std::move(word_sense));
-                    }
-                    else
-                        unknown_words.insert(key);
-                }
-            }
-            else
-                unknown_words.insert(key);
+            // inflections (runs/VBZ, ran/VBD) share the sense of their lemma
+            item.lemma = store.lemmatise(vocabulary[i].token(), item.pos);
+            // only the index is looked up - graphs are built when first used
+            item.synset = store.first_synset(item.lemma, item.pos);
+        }
+    });
+
+    // merge: one sense per lemma, for each WordNet lexical
+    for (std::size_t i = 0; i < vocabulary.size(); i++)
+    {
+        const resolved & item = resolution[i];
+        if (item.synset < 0)
+        {
+            unknown_words.insert(vocabulary[i]);
+            continue;
         }
+        known_words.insert(vocabulary[i]);
+        sense_ids[vocabulary[i]] = add_sense(item.lemma, item.pos, item.synset);
+    }
+}
+
+unsigned int semantics::add_sense(const std::string & lemma, int pos, std::uint32_t synset)
+{
+    auto it = lemma_ids[pos].find(lemma);
+    if (it == lemma_ids[pos].end())
+    {
+        it = lemma_ids[pos].insert(std::make_pair(lemma, senses.size())).first;
+        senses.emplace_back();
+        sense & word_sense = senses.back();
+        word_sense.id = it->second;
+        word_sense.query = lemma;
+        word_sense.lexical = pos;
+        word_sense.synset = synset;
     }
+    return it->second;
+}
+
+sense * semantics::resolve_sense(const word & key)
+{
+    std::lock_guard<std::mutex> lock(senses_mutex);
+    auto it = sense_ids.find(key);
+    if (it != sense_ids.end())
+        return &senses[it->second];
+
+    if (senseless.find(key) != senseless.end())
+        return nullptr;
+
+    // not resolved during construction (e.g. a rare word): resolve it now
+    int pos = mapper()(key.pos());
+    if (pos > 0)
+    {
+        std::string lemma = store.lemmatise(key.token(), pos);
+        std::int64_t synset = store.first_synset(lemma, pos);
+        if (synset >= 0)
+        {
+            unsigned int id = add_sense(lemma, pos, synset);
+            sense_ids[key] = id;
+            return &senses[id];
+        }
+    }
+    senseless.insert(key);
+    return nullptr;
+}
+
+std::vector<word> semantics::distinct_words(const std::vector<data> & dataset, unsigned int threads)
+{
+    // each thread finds the distinct words of a contiguous range of reviews
+    unsigned int chunks = std::min<std::size_t>(workers(threads), dataset.size());
+    std::size_t range = chunks > 0 ? (dataset.size() + chunks - 1) / chunks : 0;
+    std::vector<std::vector<word>> partial(chunks);
+
+    parallel_for(chunks, chunks, [&](std::size_t chunk)
+    {
+        std::unordered_set<word> seen;
+        std::size_t end = std::min(dataset.size(), (chunk + 1) * range);
+        for (std::size_t i = chunk * range; i < end; i++)
+            for (const word & key : dataset[i].words)
+                if (seen.insert(key).second)
+                    partial[chunk].push_back(key);
+    });
+
+    // merge in range order: words keep the order of their first appearance
+    std::vector<word> result;
+    std::unordered_set<word> seen;
+    for (const std::vector<word> & words : partial)
+        for (const word & key : words)
+            if (seen.insert(key).second)
+                result.push_back(key);
+
+    return result;
 }
 
 /// calculate the best delta value between two words
 float semantics::make_delta(const word & from, const word & to) 
 {
-    // check if we already have a calculated delta_path
-    // special care: tokens AND originating POS tag must match
-    auto exists = std::find_if(deltas.begin(), deltas.end(),
-                               [&](const delta & rhs)
-                               {return rhs.from == from 
-                                       && rhs.to == to;});
-
-    // delta has already been calculated
-    if (exists != deltas.end())
-        return 1.f - exists->value;
-
-    // Delta has not been calculated - let's do it now
     // find senses for both word/tag combos
-    std::unique_ptr<smnet::sense> from_sense = find_sense(from);
-    std::unique_ptr<smnet::sense> to_sense = find_sense(to);
+    sense * from_sense = find_sense(from);
+    sense * to_sense = find_sense(to);
 
     if (!from_sense || !to_sense)
         return 0.f;
 
-    std::vector<smnet::delta_path> all;
-    std::unique_ptr<smnet::delta_path> found;
+    // check if we already have a calculated delta for this pair of senses
+    std::uint64_t pair = (std::uint64_t(from_sense->id) << 32) | to_sense->id;
+    {
+        std::lock_guard<std::mutex> lock(deltas_mutex);
+        auto exists = deltas.find(pair);
+
+        // delta has already been calculated
+        if (exists != deltas.end())
+            return exists->second;
+    }
+
+    // Delta has not been calculated - let's do it now (unlocked)
+    float result = compute_delta(*from_sense, *to_sense);
+
+    std::lock_guard<std::mutex> lock(deltas_mutex);
+    deltas[pair] = result;
+    return result;
+}
+
+float semantics::compute_delta(const sense & from_sense, const sense & to_sense)
+{
+    std::vector<float> all;
+    float found;
     unsigned int max_dist = 1;
 
     // hypernym distances need min-max
-    if (from_sense->hypernyms.size() > 0
-        && to_sense->hypernyms.size() > 0)
+    if (!from_sense.hypernyms.empty()
+        && !to_sense.hypernyms.empty())
     {
         // set `max_dist` regardless of hypernym paths
-        max_dist = from_sense->hypernyms.at(0).max_distance()
-                 + to_sense->hypernyms.at(0).max_distance();
-
-        found = min_distance(from, to,
-                             from_sense->hypernyms.at(0),
-                             to_sense->hypernyms.at(0));
-        if (found)
-            all.push_back(*found);
+        max_dist = from_sense.hypernyms.max_distance
+                 + to_sense.hypernyms.max_distance;
+
+        found = min_distance(from_sense.hypernyms, to_sense.hypernyms);
+        if (found >= 0.f)
+            all.push_back(found);
     }
-    // hyponym distances are max 1, min 0
-    if (from_sense->hyponyms.size() > 0
-        && to_sense->hyponyms.size() > 0)
-    {
-        found = min_distance(from, to,
-                             from_sense->hyponyms.at(0),
-                             to_sense->hyponyms.at(0));
-        if (found)
-            all.push_back(*found);
+    // hyponym distances are layers too, but don't set `max_dist`
+    if (!from_sense.hyponyms.empty()
+        && !to_sense.hyponyms.empty())
+    {
+        found = min_distance(from_sense.hyponyms, to_sense.hyponyms);
+        if (found >= 0.f)
+            all.push_back(found);
     }
     // synonym distances are all 0.5
-    if (from_sense->synonyms.size() > 0
-        && to_sense->synonyms.size() > 0)
+    if (!from_sense.synonyms.empty()
+        && !to_sense.synonyms.empty())
     {
-        found = min_distance(from, to,
-                             from_sense->synonyms.at(0),
-                             to_sense->synonyms.at(0));
-
-        if (found)
-            all.push_back(*found);
+        found = min_distance(from_sense.synonyms, to_sense.synonyms);
+        if (found >= 0.f)
+            all.push_back(found);
     }
 
     // which one's the best?
-    auto best = std::min_element(all.begin(), all.end(), 
-                                 smnet::min_delta);
+    auto best = std::min_element(all.begin(), all.end());
+
+    // we didnt find a (best) value, hence zero
+    float result = 0.f;
 
     // if we found a best value - squash it and invert it
     if (best != all.end())
     {
         // if no hypernyms, divide by 10 (turn x into a decimal)
-        float x = best->value / 10.f;
+        float x = *best / 10.f;
 
         // hypernyms exist - min-max normalize with `max_dist`
         if (max_dist > 1)
-            x = (best->value - 0.f) / (max_dist - 0.f); 
-
-        deltas.insert(delta{from, to, x});
+            x = (*best - 0.f) / (max_dist - 0.f); 
 
         // invert value (1 same, 0 not-same)
-        return 1.f - x;
+        result = 1.f - x;
+    }
+    return result;
+}
+
+/// get the graph nodes of @param key which `make_delta` may intersect
+relatives semantics::related(const word & key)
+{
+    relatives result;
+    sense * arg = find_sense(key);
+    if (!arg)
+        return result;
+
+    result.query = arg->query;
+
+    if (!arg->hypernyms.empty())
+    {
+        result.depth = arg->hypernyms.max_distance;
+        for (const auto & node : arg->hypernyms.nodes)
+            result.hypernyms.push_back(node.first);
     }
 
-    // we didnt find a (best) value, hence return zero
-    return 0.f;
+    for (const auto & node : arg->hyponyms.nodes)
+        result.hyponyms.push_back(node.first);
+
+    for (const auto & node : arg->synonyms.nodes)
+        result.synonyms.push_back(node.first);
+
+    return result;
+}
+
+/// cheap upper bound of `make_delta(from, to)`
+float semantics::delta_bound(const std::string & from_query, int from_depth,
+                             const std::string & to_query, int to_depth)
+{
+    // the same query (lemma) may be found at distance zero
+    if (from_query == to_query)
+        return 1.f;
+
+    // `make_delta` squashes with the sum of hypernym depths, or by 10
+    unsigned int max_dist = 10;
+    if (from_depth >= 0 && to_depth >= 0 && from_depth + to_depth > 1)
+        max_dist = from_depth + to_depth;
+
+    // different queries are at least `min_step` apart
+    return 1.f - (min_step / max_dist);
 }
 
 /// find the sense containing this word
-std::unique_ptr<smnet::sense> semantics::find_sense(const word & key) 
+sense * semantics::find_sense(const word & key)
 {
-    // get WN Lexical using mapper
-    int pos = mapper()(key.tag);
-    for (const smnet::sense & sense : senses)
-        if (sense.query == key.token && sense.lexical == pos)
-            return std::move(std::make_unique<smnet::sense>(sense));
+    sense * arg = resolve_sense(key);
+    if (arg)
+        load(*arg);
 
-    return nullptr;
+    return arg;
 }
 
-std::unique_ptr<smnet::delta_path> semantics::min_distance(
-                                                            const word & from,
-                                                            const word & to,
-                                                            const smnet::graph & from_graph,
-                                                            const smnet::graph & to_graph
-                                                          )
+void semantics::load(sense & arg)
 {
-    // find all common words in both hypergraphs
-    auto common = smnet::word_intersections(from_graph, to_graph);
-    std::vector<smnet::delta_path> total;
-           
-    // get all distances 
-    for (const std::string & key : common)
-    {  
-        // distance `from` to `common`
-        smnet::path_finder p_finder1(from_graph);
-        std::unique_ptr<smnet::delta_path> p_from_key = p_finder1(from.token, key);
-
-        // distance: `to` to `common`
-        smnet::path_finder p_finder2(to_graph);
-        std::unique_ptr<smnet::delta_path> p_to_key = p_finder2(to.token, key);
-
-        // if both deltas are valid
-        if (p_from_key && p_to_key)
-            total.push_back(smnet::delta_path(from.token, to.token,
-                                    (p_from_key->value + p_to_key->value)));
+    std::call_once(arg.loaded, [&]
+    {
+        // hypernyms are measured to their full depth: it normalises `make_delta`
+        expand(arg, up_pointers, arg.hypernyms, true);
+        expand(arg, down_pointers, arg.hyponyms, false);
+
+        // synonyms: the words of the first synset
+        const synset & first = store.at(arg.synset);
+        for (unsigned int i = 0; i < first.words_count; i++)
+            arg.synonyms.nodes.emplace(store.word(first, i), synonym_step);
+        arg.synonyms.nodes[arg.query] = 0.f;
+    });
+}
+
+void semantics::expand(
+                         const sense & arg,
+                         const std::vector<relation> & pointers,
+                         sense_graph & graph,
+                         bool measure
+                       )
+{
+    std::deque<std::pair<std::uint32_t, unsigned int>> queue = {std::make_pair(arg.synset, 0u)};
+    std::unordered_set<std::uint32_t> visited = {arg.synset};
+
+    // breadth first: each word is first met at its shortest layer
+    while (!queue.empty())
+    {
+        std::uint32_t id = queue.front().first;
+        unsigned int layer = queue.front().second;
+        queue.pop_front();
+        const synset & item = store.at(id);
+
+        if (layer > 0)
+        {
+            // no words past `max_depth`
+            if (max_depth == 0 || layer <= max_depth)
+                for (unsigned int i = 0; i < item.words_count; i++)
+                    graph.nodes.emplace(store.word(item, i), layer * layer_step);
+            graph.max_distance = std::max(graph.max_distance, int(layer));
+        }
+
+        // stop expanding at `max_depth`, unless the graph is measured to its end
+        if (measure || max_depth == 0 || layer < max_depth)
+            for (unsigned int i = 0; i < item.pointers_count; i++)
+            {
+                const pointer & link = store.link(item, i);
+                if (std::find(pointers.begin(), pointers.end(), link.type) != pointers.end()
+                    && visited.insert(link.target).second)
+                    queue.push_back(std::make_pair(link.target, layer + 1));
+            }
     }
 
-    // sort through `total` and find the ones with the smallest distance
-    auto best = std::min_element(total.begin(), total.end(), smnet::min_delta);
+    // the query is the start of every path
+    if (!graph.empty())
+        graph.nodes[arg.query] = 0.f;
+}
 
-    // found the best - return a pointer to it
-    if (best != total.end())
-        return std::move(std::unique_ptr<smnet::delta_path>(new smnet::delta_path(*best)));
+float semantics::min_distance(const sense_graph & from_graph, const sense_graph & to_graph)
+{
+    // walk the smaller graph, look up common words in the larger one
+    const sense_graph & small = from_graph.nodes.size() < to_graph.nodes.size() ? from_graph : to_graph;
+    const sense_graph & large = from_graph.nodes.size() < to_graph.nodes.size() ? to_graph : from_graph;
+    float best = -1.f;
 
-    // no discovered distance
-    else
-        return nullptr;
+    // distance `from` to `common` plus `to` to `common`
+    for (const auto & node : small.nodes)
+    {
+        auto common = large.nodes.find(node.first);
+        if (common != large.nodes.end())
+        {
+            float value = node.second + common->second;
+            if (best < 0.f || value < best)
+                best = value;
+        }
+    }
+    return best;
 }
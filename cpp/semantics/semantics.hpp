@@ -3,21 +3,114 @@
 #include "includes.ihh"
 
 ///
-/// All semantic queries (smnet::graph) stored in here
+/// a relation graph of a sense, flattened to the distance of each word from the query
+/// the query itself is at distance zero - the start of every path
+///
+struct sense_graph
+{
+    // word -> shortest distance from the query
+    std::unordered_map<std::string, float> nodes;
+    // the deepest layer reached - for a measured graph (@see `semantics::expand`)
+    // the deepest of the whole relation, even past the expansion depth
+    int max_distance = 0;
+
+    bool empty() const
+    {
+        return nodes.empty();
+    }
+};
+
+///
+/// the first WordNet sense of a lemma, and its hypernym, hyponym and synonym graphs
+/// graphs are only built the first time the sense is used
+///
+struct sense
+{
+    // sense id (position in `semantics::senses`)
+    unsigned int id;
+    // the lemma queried
+    std::string query;
+    // WordNet lexical (NOUN, VERB, ADJECTIVE or ADVERB)
+    int lexical;
+    // WordNet synset id of the first sense
+    std::uint32_t synset;
+    // graphs are built once, by whichever thread needs them first
+    std::once_flag loaded;
+
+    sense_graph hypernyms;
+    sense_graph hyponyms;
+    sense_graph synonyms;
+};
+
+///
+/// words (nodes) found in the hypernym, hyponym and synonym graph of a sense
+/// these are the only graphs `make_delta` compares
+///
+struct relatives
+{
+    // the (lemmatised) query of the sense, the start node of every graph
+    std::string query;
+    std::vector<std::string> hypernyms;
+    std::vector<std::string> hyponyms;
+    std::vector<std::string> synonyms;
+    // full depth of the hypernym graph (whatever the expansion depth), -1 if there are no hypernyms
+    int depth = -1;
+};
+
+///
+/// All semantic queries (sense graphs) stored in here
 /// Also, filter unknown words, and return them so that
 /// we can infer which words are compressable via semantic relations
 ///
 /// WordNet only contains "open-class words": nouns, verbs, adjectives, and adverbs. 
 /// Thus, excluded words include determiners, prepositions, pronouns, conjunctions, and particles.
 ///
+/// once constructed, `make_delta` and `related` may be called from several threads:
+/// lazy resolution and the delta cache are locked, graphs are built once per sense
+///
 struct semantics
 {
     // construct by passing the word stats which we'll query
-    semantics(const std::vector<data> & dataset);
+    // @param max_depth bounds hypernym/hyponym expansion (0 is unbounded)
+    // @param threads resolves distinct words in parallel (0 uses all cores)
+    semantics(
+               const std::vector<data> & dataset,
+               unsigned int max_depth = 0,
+               unsigned int threads = 0
+             );
+
+    // construct from corpus @param frequencies (see `miner::frequencies`)
+    // only words more frequent than @param threshold are resolved (and their graphs built) now,
+    // any other word is resolved the first time its similarity is needed
+    semantics(
+               const std::unordered_map<word, unsigned int> & frequencies,
+               unsigned int threshold,
+               unsigned int max_depth = 0,
+               unsigned int threads = 0
+             );
 
     /// calculate the best delta value between two words
+    /// @note cached per sense pair, so inflections sharing a lemma share the result
     float make_delta(const word & from, const word & to) ;
 
+    /// get the graph nodes of @param key which `make_delta` may intersect
+    /// @note all lists are empty if @param key has no sense
+    relatives related(const word & key);
+
+    /// cheap upper bound of `make_delta(from, to)` using only the hypernym graph depths
+    /// @param from_query, @param to_query are `relatives::query` 
+    /// @param from_depth and @param to_depth are `relatives::depth`
+    static float delta_bound(const std::string & from_query, int from_depth,
+                             const std::string & to_query, int to_depth);
+
+    /// distance of each hypernym/hyponym layer, and of a synonym from the query
+    static constexpr float layer_step = 1.f;
+    static constexpr float synonym_step = 0.5f;
+
+    /// smallest distance between two different words in any graph: every node
+    /// other than the query is at least one step away, so `delta_bound` holds
+    static constexpr float min_step = layer_step < synonym_step ? layer_step : synonym_step;
+
     // get all unknown words - token & tag 
     std::unordered_set<word> unknown_words;
     // get all known words - token & tag
@@ -25,26 +118,63 @@ struct semantics
 
 private:
 
-    /// find the sense(s) containing this word
-    /// @note more than one sense may be returned
-    ///       depending on the POS of the key
-    std::unique_ptr<smnet::sense> find_sense(const word & key);
+    /// the distinct words (token/tag) of @param dataset, in order of first appearance
+    static std::vector<word> distinct_words(const std::vector<data> & dataset, unsigned int threads);
+
+    /// resolve the senses of @param vocabulary into `known_words` and `unknown_words`
+    void resolve(const std::vector<word> & vocabulary, unsigned int threads);
+
+    /// the sense id of @param lemma (as @param pos), added if new
+    unsigned int add_sense(const std::string & lemma, int pos, std::uint32_t synset);
+
+    /// the sense of @param key, resolved now if needed - nullptr if it has none
+    /// @note the graphs may not be built yet
+    sense * resolve_sense(const word & key);
+
+    /// find the sense of this word (token/tag) - nullptr if it has none
+    /// @note resolves the word and builds the sense graphs if not already done
+    sense * find_sense(const word & key);
+
+    /// build the graphs of sense @param arg (once - thread-safe)
+    void load(sense & arg);
+
+    /// calculate the delta between two senses with built graphs
+    float compute_delta(const sense & from_sense, const sense & to_sense);
 
-    /// find the smallest distance between two words in two graphs
-    std::unique_ptr<smnet::delta_path> min_distance(
-                                                     const word & from,
-                                                     const word & to,
-                                                     const smnet::graph & from_graph,
-                                                     const smnet::graph & to_graph
-                                                   );
+    /// breadth-first expansion of @param arg following WordNet @param pointers
+    /// up to `max_depth` layers, each word is placed at its shortest layer
+    /// if @param measure, layers past `max_depth` are walked (without nodes) for `max_distance`
+    void expand(
+                 const sense & arg,
+                 const std::vector<relation> & pointers,
+                 sense_graph & graph,
+                 bool measure
+               );
 
-    /// find the maximum distance within the graph
-    /// this requires some kind of heuristics or I have to update `semanet`
+    /// find the smallest distance between the queries of two graphs, through a common word
+    /// @return a negative value if there is no common word
+    float min_distance(const sense_graph & from_graph, const sense_graph & to_graph);
 
+    // in-memory WordNet
+    const wordnet & store;
+    // max expansion depth of hypernym and hyponym graphs (0 is unbounded)
+    const unsigned int max_depth;
     // keep track of calculated deltas so we don't have to repeat searches
-    std::unordered_set<delta> deltas;
-    // semantic hyper-space is a vector of vectors of graphs
+    // key is the `from` sense id (high 32 bits) and the `to` sense id (low 32 bits)
+    std::unordered_map<std::uint64_t, float> deltas;
+    // guards `deltas`
+    std::mutex deltas_mutex;
+    // semantic hyper-space is a deque of senses (references stay valid as it grows)
     // each sense is a triplet: hypernyms, hyponyms, synonyms
-    std::vector<smnet::sense> senses;
+    // senses are queried by lemma, their position is the sense id
+    std::deque<sense> senses;
+    // guards `senses`, `sense_ids`, `senseless` and `lemma_ids` when resolving lazily
+    std::mutex senses_mutex;
+    // map each known word (token/tag) to its sense id
+    std::unordered_map<word, unsigned int> sense_ids;
+    // words resolved without a sense
+    std::unordered_set<word> senseless;
+    // lemma to sense id, for each WordNet lexical
+    std::unordered_map<std::string, unsigned int> lemma_ids[5];
 };
 #endif
@@ -0,0 +1,112 @@
+#include "symbols.hpp"
+
+const std::uint64_t string_table::first_chunk;
+const unsigned int string_table::max_chunks;
+const std::uint32_t symbols::unknown;
+
+string_table::string_table()
+: count(0)
+{
+    for (auto & chunk : chunks)
+        chunk.store(nullptr, std::memory_order_relaxed);
+}
+
+string_table::~string_table()
+{
+    for (auto & chunk : chunks)
+        delete[] chunk.load(std::memory_order_relaxed);
+}
+
+unsigned int string_table::chunk_of(std::uint32_t id, std::uint64_t & position)
+{
+    // chunk k starts at `first_chunk * (2^k - 1)`
+    unsigned int k = 0;
+    position = id;
+    while (position >= (first_chunk << k))
+        position -= first_chunk << k++;
+    return k;
+}
+
+std::uint32_t string_table::push_back(const std::string & value)
+{
+    std::uint32_t id = count.load(std::memory_order_relaxed);
+    if (id == std::numeric_limits<std::uint32_t>::max())
+        throw std::runtime_error("symbol table is full");
+
+    std::uint64_t position;
+    unsigned int k = chunk_of(id, position);
+    std::string * chunk = chunks[k].load(std::memory_order_relaxed);
+    if (!chunk)
+    {
+        chunk = new std::string[first_chunk << k];
+        chunks[k].store(chunk, std::memory_order_relaxed);
+    }
+    chunk[position] = value;
+
+    // readers acquiring the new count see the string and its chunk
+    count.store(id + 1, std::memory_order_release);
+    return id;
+}
+
+const std::string & string_table::at(std::uint32_t id) const
+{
+    if (id >= size())
+        throw std::out_of_range("unknown symbol id");
+
+    std::uint64_t position;
+    unsigned int k = chunk_of(id, position);
+    return chunks[k].load(std::memory_order_relaxed)[position];
+}
+
+std::unique_ptr<symbols> symbols::__singleton = nullptr;
+static std::once_flag s_onceFlag;
+
+symbols & symbols::singleton()
+{
+    std::call_once(s_onceFlag, []{__singleton.reset(new symbols);});
+    return *__singleton.get();
+}
+
+symbols::symbols()
+{
+    // the empty token and tag (a default `word`) are id 0,
+    // Penn tags are interned first: their ids are their `penn` values
+    token("");
+    for (unsigned int i = 0; i < penn_count; i++)
+        tag(penn_names[i]);
+}
+
+std::uint32_t symbols::token(const std::string & token)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = token_ids.find(token);
+    if (it != token_ids.end())
+        return it->second;
+
+    std::uint32_t id = tokens.push_back(token);
+    token_ids.emplace(token, id);
+    return id;
+}
+
+std::uint32_t symbols::find(const std::string & token)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = token_ids.find(token);
+    return it != token_ids.end() ? it->second : unknown;
+}
+
+std::uint8_t symbols::tag(const std::string & tag)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = tag_ids.find(tag);
+    if (it != tag_ids.end())
+        return it->second;
+
+    if (tags.size() > 255)
+        throw std::runtime_error("too many POS tags, can't intern `"+tag+"`");
+
+    std::uint8_t id = tags.push_back(tag);
+    tag_ids.emplace(tag, id);
+    return id;
+}
+
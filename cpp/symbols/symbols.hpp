@@ -0,0 +1,108 @@
+#ifndef NLP_ENCODER_SYMBOLS
+#define NLP_ENCODER_SYMBOLS
+#include "includes.ihh"
+///
+/// append-only strings by id, stored in chunks which are allocated once and never move:
+/// chunk k holds `first_chunk * 2^k` strings. Appends must be serialised by the caller,
+/// reads are lock-free - an id below `size()` is fully written
+///
+class string_table
+{
+public:
+
+    string_table();
+
+    ~string_table();
+
+    /// No Copying allowed
+    string_table(const string_table &) = delete;
+
+    // No assignment Allowed
+    string_table& operator=(const string_table &) = delete;
+
+    /// append @param value, @return its id
+    std::uint32_t push_back(const std::string & value);
+
+    /// @return the string of id @param id
+    /// @throw if @param id hasn't been appended
+    const std::string & at(std::uint32_t id) const;
+
+    std::uint32_t size() const
+    {
+        return count.load(std::memory_order_acquire);
+    }
+
+private:
+
+    /// the chunk of @param id, and @param id's position in it
+    static unsigned int chunk_of(std::uint32_t id, std::uint64_t & position);
+
+    /// strings in the first chunk
+    static const std::uint64_t first_chunk = 1024;
+    /// enough chunks for every 32-bit id
+    static const unsigned int max_chunks = 24;
+    /// chunks, allocated by the append which needs them
+    std::atomic<std::string*> chunks[max_chunks];
+    /// strings appended - published (release) after each string is written
+    std::atomic<std::uint32_t> count;
+};
+///
+/// global symbol table interning tokens and (Penn) POS tags:
+/// each distinct string gets the next integer id, for the process lifetime.
+/// Id 0 is the empty string, and Penn tag ids are their `penn` values. Interning and lookups are thread-safe,
+/// and looked up strings stay valid as the table grows. Interning locks, looking up a string by id doesn't
+///
+class symbols
+{
+public:
+
+    static symbols & singleton();
+
+    /// No Copying allowed
+    symbols(const symbols &) = delete;
+
+    // No assignment Allowed
+    symbols& operator=(const symbols &) = delete;
+
+    /// id of no interned token - the table never grows that large
+    static const std::uint32_t unknown = std::numeric_limits<std::uint32_t>::max();
+
+    /// @return the id of @param token, interning it if it's new
+    std::uint32_t token(const std::string & token);
+
+    /// @return the id of @param token, or `unknown` if it was never interned
+    std::uint32_t find(const std::string & token);
+
+    /// @return the id of @param tag, interning it if it's new
+    /// @throw if more than 256 distinct tags are interned
+    std::uint8_t tag(const std::string & tag);
+
+    /// @return the token of id @param id (lock-free)
+    const std::string & token(std::uint32_t id) const
+    {
+        return tokens.at(id);
+    }
+
+    /// @return the tag of id @param id (lock-free)
+    const std::string & tag(std::uint8_t id) const
+    {
+        return tags.at(id);
+    }
+
+private:
+
+    /// private c'tor
+    symbols();
+
+    /// This class signleton instance
+    static std::unique_ptr<symbols> __singleton;
+    /// guards interning
+    std::mutex mutex;
+    /// strings by id
+    string_table tokens;
+    string_table tags;
+    /// id of each string
+    std::unordered_map<std::string, std::uint32_t> token_ids;
+    std::unordered_map<std::string, std::uint8_t> tag_ids;
+};
+#endif
@@ -103,6 +103,8 @@ class CRF_Model
     void decode_nbest(CRF_Sequence & s0, std::vector<std::pair<double, std::vector<std::string> > > & nbest, const int num, const double min_prob);
     
     void decode_lookahead(CRF_Sequence & s0);
+
+    void decode_lookahead(CRF_Sequence & s0, std::vector<int> & labels);
     
     bool load_from_file(const std::string & filename, bool verbose = true);
     
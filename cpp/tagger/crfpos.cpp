@@ -156,6 +156,18 @@ void crf_decode_lookahead (
   }
 }
 
+void crf_decode_lookahead (
+                            Sentence & s,
+                            CRF_Model & m,
+                            vector<int> & labels
+                          )
+{
+  CRF_Sequence cs;
+  for (size_t j = 0; j < s.size(); j++) cs.add_state(crfstate(s, j));
+
+  m.decode_lookahead(cs, labels);
+}
+
 void crf_decode_forward_backward (
                                    Sentence & s,
                                    CRF_Model & m,
@@ -4,6 +4,7 @@ using namespace std;
 
 std::unique_ptr<la_pos> la_pos::__singleton = nullptr;
 std::once_flag l_onceFlag;
+const unsigned int la_pos::MAX_TOKENS;
 
 la_pos & la_pos::singleton()
 {
@@ -16,33 +17,69 @@ la_pos::la_pos()
     /// Load the actual model - model.la appears to be some kind of lookup table of probabilities
     if (!crfm.load_from_file("model.la"))
         throw std::runtime_error("laPOS no model to load");
+
+    // a tag's id is its Penn value - each label is interned once, here
+    for (int i = 0; i < crfm.num_classes(); i++)
+        label_tags.push_back(static_cast<penn>(symbols::singleton().tag(crfm.get_class_label(i))));
 }
 
-std::vector<std::pair<std::string,std::string>> la_pos::operator()(std::string line)
+unsigned int la_pos::count(const std::string & line) const
 {
-    // vt will hold the tokenised string
+    // same tokenization as `operator()`, each token is tagged once
     vector<Token> vt;
+    tokenize( line, vt, false );
+    return std::min<std::size_t>(vt.size(), MAX_TOKENS);
+}
+
+void la_pos::tokenize_line(const std::string & line, std::vector<Token> & vt, std::vector<std::string> & tokens)
+{
     // Tokenization
     tokenize( line, vt, false );
 
     // Tokenize up to 990 chars
-    if ( vt.size() > 990 )
+    if ( vt.size() > MAX_TOKENS )
     {
         //cerr << "warning: the sentence is too long. it has been truncated." << endl;
-        while ( vt.size() > 990 ) vt.pop_back();
+        while ( vt.size() > MAX_TOKENS ) vt.pop_back();
     }
 
     // convert parantheses
-    vector<string> org_strs;
     for ( vector<Token>::iterator i = vt.begin(); i != vt.end(); i++ )
     {
-        org_strs.push_back(i->str);
+        tokens.push_back(i->str);
         i->str = paren_converter.Ptb2Pos(i->str);
         i->prd = "?";
     }
 
     if ( vt.size() == 0 )
         throw std::runtime_error("laPOS Process: empty @param line");
+}
+
+std::vector<std::pair<std::string,penn>> la_pos::tag(std::string line)
+{
+    vector<Token> vt;
+    vector<string> tokens;
+    tokenize_line(line, vt, tokens);
+
+    // the lookahead decoder's label is the one `operator()` picks (its only, certain, tag)
+    vector<int> labels;
+    crf_decode_lookahead(vt, crfm, labels);
+
+    std::vector<std::pair<std::string,penn>> result;
+    result.reserve(labels.size());
+    for (size_t i = 0; i < labels.size(); i++)
+        result.push_back(std::make_pair(std::move(tokens[i]), label_tags[labels[i]]));
+
+    crfm.incr_line_counter();
+    return result;
+}
+
+std::vector<std::pair<std::string,std::string>> la_pos::operator()(std::string line)
+{
+    // vt will hold the tokenised string
+    vector<Token> vt;
+    vector<string> org_strs;
+    tokenize_line(line, vt, org_strs);
 
     // Store a string and a doule which I am assuming is a probability value
     vector< map<string, double> > tagp0, tagp1;
@@ -1,6 +1,7 @@
 #ifndef __la_pos_HPP_
 #define __la_pos_HPP_
 #include "Includes.hxx"
+#include "../symbols/symbols.hpp"
 
 /// method is declared in lookahread.cpp
 void tokenize (
@@ -16,6 +17,13 @@ void crf_decode_lookahead (
                             std::vector< std::map< std::string, double> > & tagp 
                           );
 
+/// method is declared in crfpos.cpp
+void crf_decode_lookahead (
+                            Sentence & s,
+                            CRF_Model & m,
+                            std::vector<int> & labels
+                          );
+
 /// wrapper around the laPOS tagger
 class la_pos
 {
@@ -32,20 +40,33 @@ public:
     /// Parse a line into a vector of strings/tags
     std::vector<std::pair<std::string,std::string>> operator()(std::string line);
 
+    /// Parse a line into a vector of strings/Penn tags
+    /// @note non-Penn tags are interned past `penn::count` when the model loads (@see `symbols`)
+    std::vector<std::pair<std::string,penn>> tag(std::string line);
+
+    /// Count the tokens `operator()` would tag in a line, without tagging it
+    unsigned int count(const std::string & line) const;
+
 private:
 
     /// private c'tor
     la_pos();
 
+    /// Tokenize @param line into @param vt (converted for the model) and its @param tokens
+    void tokenize_line(const std::string & line, std::vector<Token> & vt, std::vector<std::string> & tokens);
 
     /// This class signleton instance
     static std::unique_ptr<la_pos> __singleton;
     /// Actual CRF Model Object
     CRF_Model crfm;
+    /// Penn tag of each model label id
+    std::vector<penn> label_tags;
     // the default directory for saving the models
     std::string MODEL_DIR = ".";
     // suppress output of tags with a very low probability
     const double PROB_OUTPUT_THRESHOLD = 0.001;
+    /// Tokens tagged per line, longer lines are truncated
+    static const unsigned int MAX_TOKENS = 990;
     /// Parenthesis Converter ?
     ParenConverter paren_converter;
 
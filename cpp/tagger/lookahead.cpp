@@ -335,6 +335,18 @@ int CRF_Model::decode_lookahead_sentence(const Sequence & seq, vector<int> & vs)
 
 void CRF_Model::decode_lookahead(CRF_Sequence & s0)
 {
+  vector<int> vs;
+  decode_lookahead(s0, vs);
+
+  for (size_t i = 0; i < vs.size(); i++) {
+    s0.vs[i].label = _label_bag.Str(vs[i]);
+  }
+}
+
+// the label ids (< num_classes()) of a sequence, without their strings
+void CRF_Model::decode_lookahead(CRF_Sequence & s0, vector<int> & vs)
+{
+  vs.clear();
   if (s0.vs.size() >= MAX_LEN) {
     cerr << "error: sequence is too long." << endl;
     return;
@@ -351,10 +363,6 @@ void CRF_Model::decode_lookahead(CRF_Sequence & s0)
     seq.vs.push_back(s);
   }
   
-  vector<int> vs(seq.vs.size());
+  vs.resize(seq.vs.size());
   decode_lookahead_sentence(seq, vs);
-
-  for (size_t i = 0; i < seq.vs.size(); i++) {
-    s0.vs[i].label = _label_bag.Str(vs[i]);
-  }
 }
@@ -16,25 +16,63 @@ struct tokenizer
         for (data & row : dataset)
         {
             // get the mixed tokenized text with respective pos tag
-            std::vector<std::pair<std::string,std::string>> mixed = tagger(row.review);
+            std::vector<std::pair<std::string,penn>> mixed = tagger.tag(row.review);
             // populate `row.words` and `row.tags` respectively
-            for (const std::pair<std::string,std::string> & item : mixed)
+            for (const std::pair<std::string,penn> & item : mixed)
                 // set word, pos tag
-                row.words.push_back((word){item.first, item.second});
+                row.words.push_back(word(item.first, item.second));
         }
     }
 
-    /// filter the data-set, excluding reviews which have more words than `max_length`
-    std::vector<data> filter(const std::vector<data> & dataset, unsigned int max_length)
+    /// filter the data-set in place, excluding reviews which have more words than `max_length`
+    void filter(std::vector<data> & dataset, unsigned int max_length)
     {
-        std::vector<data> result;
-        for (const data & review : dataset)
-            if (review.words.size() < max_length)
-                result.push_back(review);
+        dataset.erase(std::remove_if(dataset.begin(), dataset.end(),
+                                     [&](const data & review)
+                                     { return review.words.size() >= max_length; }),
+                      dataset.end());
+    }
+
+    /// filter the untagged data-set in place, by the word count tagging would produce
+    /// @note same result as `filter` after tagging, without tagging the excluded reviews
+    void prefilter(std::vector<data> & dataset, unsigned int max_length)
+    {
+        dataset.erase(std::remove_if(dataset.begin(), dataset.end(),
+                                     [&](const data & review)
+                                     { return tagger.count(review.review) >= max_length; }),
+                      dataset.end());
+    }
 
+    /// @return the untagged reviews of @param reviews which tagging would give less than `max_length` words
+    corpus::view prefilter(const corpus & arg, const corpus::view & reviews, unsigned int max_length)
+    {
+        corpus::view result;
+        for (std::uint32_t i : reviews.indices)
+            if (tagger.count(arg.review(i)) < max_length)
+                result.indices.push_back(i);
         return result;
     }
 
+    /// tag the @param reviews of @param arg, in one pass over the text arena
+    /// @note reviews outside @param reviews are left without words
+    void operator()(corpus & arg, const corpus::view & reviews)
+    {
+        std::vector<char> selected(arg.size(), 0);
+        for (std::uint32_t i : reviews.indices)
+            selected[i] = 1;
+
+        std::vector<word> flat;
+        std::vector<std::uint64_t> offsets = {0};
+        for (std::size_t i = 0; i < arg.size(); i++)
+        {
+            if (selected[i])
+                for (const std::pair<std::string,penn> & item : tagger.tag(arg.review(i)))
+                    flat.push_back(word(item.first, item.second));
+            offsets.push_back(flat.size());
+        }
+        arg.assign_words(std::move(flat), std::move(offsets));
+    }
+
     unsigned int max_size(const std::vector<data> & dataset)
     {
         unsigned int largest = 0;
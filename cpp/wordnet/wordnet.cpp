@@ -0,0 +1,361 @@
+#include "wordnet.hpp"
+
+std::unique_ptr<wordnet> wordnet::__singleton = nullptr;
+static std::once_flag w_onceFlag;
+
+/// dict file suffix of each part of speech
+static const char * pos_names[5] = {"", "noun", "verb", "adj", "adv"};
+
+/// detachment rules (suffix, ending) of each part of speech - WordNet's morph.c
+static const std::vector<std::pair<std::string,std::string>> rules[5] =
+{
+    {},
+    {{"s", ""}, {"ses", "s"}, {"xes", "x"}, {"zes", "z"},
+     {"ches", "ch"}, {"shes", "sh"}, {"men", "man"}, {"ies", "y"}},
+    {{"s", ""}, {"ies", "y"}, {"es", "e"}, {"es", ""},
+     {"ed", "e"}, {"ed", ""}, {"ing", "e"}, {"ing", ""}},
+    {{"er", ""}, {"est", ""}, {"er", "e"}, {"est", "e"}},
+    {}
+};
+
+static std::uint64_t fnv1a(const std::string & arg)
+{
+    std::uint64_t hash = 14695981039346656037ULL;
+    for (unsigned char c : arg)
+    {
+        hash ^= c;
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+static std::uint64_t mix(std::uint64_t x)
+{
+    x += 0x9e3779b97f4a7c15ULL;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+/// slot of a lemma hash displaced by @param seed
+static std::uint64_t displace(std::uint64_t hash, std::uint32_t seed)
+{
+    return mix(hash ^ (std::uint64_t(seed) * 0xff51afd7ed558ccdULL));
+}
+
+/// part of speech of a data file pointer (satellites are adjectives)
+static int pos_of(char arg)
+{
+    switch (arg)
+    {
+        case 'n': return 1;
+        case 'v': return 2;
+        case 'a': case 's': return 3;
+        case 'r': return 4;
+        default: throw std::runtime_error(std::string("unknown WordNet pos `")+arg+"`");
+    }
+}
+
+static relation relation_of(const std::string & symbol)
+{
+    if (symbol == "@")  return relation::hypernym;
+    if (symbol == "@i") return relation::instance_hypernym;
+    if (symbol == "~")  return relation::hyponym;
+    if (symbol == "~i") return relation::instance_hyponym;
+    return relation::other;
+}
+
+static bool ends_with(const std::string & arg, const std::string & suffix)
+{
+    return arg.size() >= suffix.size()
+           && arg.compare(arg.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+void lemma_index::build(const std::vector<std::string> & lemmas)
+{
+    unsigned int n = lemmas.size();
+    std::vector<std::uint64_t> hashes(n);
+    for (unsigned int i = 0; i < n; i++)
+    {
+        hashes[i] = fnv1a(lemmas[i]);
+        offsets.push_back(arena.size());
+        arena += lemmas[i];
+        arena.push_back('\0');
+    }
+
+    // around four lemmas per bucket, 25% spare slots
+    seeds.assign(n / 4 + 1, 0);
+    slots.assign(n + n / 4 + 1, -1);
+    std::vector<std::vector<unsigned int>> buckets(seeds.size());
+    for (unsigned int i = 0; i < n; i++)
+        buckets[mix(hashes[i]) % buckets.size()].push_back(i);
+
+    // place the largest buckets first, while most slots are free
+    std::vector<unsigned int> order(buckets.size());
+    for (unsigned int b = 0; b < order.size(); b++)
+        order[b] = b;
+    std::stable_sort(order.begin(), order.end(), [&](unsigned int lhs, unsigned int rhs)
+                     { return buckets[lhs].size() > buckets[rhs].size(); });
+
+    std::vector<std::uint64_t> placed;
+    for (unsigned int b : order)
+    {
+        if (buckets[b].empty())
+            break;
+
+        for (std::uint32_t seed = 1; ; seed++)
+        {
+            if (seed == (1u << 24))
+                throw std::runtime_error("lemma_index: no displacement found");
+
+            placed.clear();
+            bool free = true;
+            for (unsigned int i : buckets[b])
+            {
+                std::uint64_t slot = displace(hashes[i], seed) % slots.size();
+                if (slots[slot] >= 0
+                    || std::find(placed.begin(), placed.end(), slot) != placed.end())
+                {
+                    free = false;
+                    break;
+                }
+                placed.push_back(slot);
+            }
+
+            if (free)
+            {
+                for (unsigned int k = 0; k < placed.size(); k++)
+                    slots[placed[k]] = buckets[b][k];
+                seeds[b] = seed;
+                break;
+            }
+        }
+    }
+}
+
+int lemma_index::find(const std::string & lemma) const
+{
+    if (slots.empty())
+        return -1;
+
+    std::uint64_t hash = fnv1a(lemma);
+    std::uint32_t seed = seeds[mix(hash) % seeds.size()];
+    std::int32_t entry = slots[displace(hash, seed) % slots.size()];
+
+    // the slot may hold another lemma (or none) if `lemma` isn't indexed
+    if (entry >= 0
+        && arena.compare(offsets[entry], lemma.size(), lemma) == 0
+        && arena[offsets[entry] + lemma.size()] == '\0')
+        return entry;
+
+    return -1;
+}
+
+const wordnet & wordnet::singleton()
+{
+    std::call_once(w_onceFlag, []
+    {
+        const char * path = std::getenv("WNSEARCHDIR");
+        __singleton.reset(new wordnet(path ? path : "/usr/local/WordNet-3.0/dict"));
+    });
+    return *__singleton.get();
+}
+
+wordnet::wordnet(const std::string & path)
+{
+    load_data(path);
+    load_index(path);
+    load_exceptions(path);
+}
+
+bool wordnet::exists(const std::string & lemma, int pos) const
+{
+    return lemmas[pos].find(lemma) >= 0;
+}
+
+std::string wordnet::lemmatise(const std::string & token, int pos) const
+{
+    // WordNet lemmas are lower-case, collocations joined by `_`
+    std::string lower = token;
+    for (char & c : lower)
+        c = (c == ' ') ? '_' : std::tolower(static_cast<unsigned char>(c));
+
+    // a surface form which is itself a lemma is kept ("feed", "goods"), as by morphy
+    if (exists(lower, pos))
+        return lower;
+
+    // then irregular forms
+    auto irregular = exceptions[pos].find(lower);
+    if (irregular != exceptions[pos].end())
+        return irregular->second;
+
+    if (pos == 1 && (ends_with(lower, "ss") || lower.size() <= 2))
+        return lower;
+
+    // the first suffix rule producing an indexed lemma
+    for (const auto & rule : rules[pos])
+    {
+        if (lower.size() > rule.first.size() && ends_with(lower, rule.first))
+        {
+            std::string base = lower.substr(0, lower.size() - rule.first.size()) + rule.second;
+            if (exists(base, pos))
+                return base;
+        }
+    }
+    return lower;
+}
+
+std::int64_t wordnet::first_synset(const std::string & lemma, int pos) const
+{
+    int entry = lemmas[pos].find(lemma);
+    if (entry < 0 || senses_begin[pos][entry] == senses_begin[pos][entry + 1])
+        return -1;
+
+    return senses[pos][senses_begin[pos][entry]];
+}
+
+std::uint32_t wordnet::synset_id(int pos, std::uint32_t offset) const
+{
+    auto first = synset_offsets.begin() + pos_begin[pos];
+    auto last = synset_offsets.begin() + pos_begin[pos + 1];
+    auto it = std::lower_bound(first, last, offset);
+    if (it == last || *it != offset)
+        throw std::runtime_error("no WordNet synset at offset "+std::to_string(offset));
+
+    return it - synset_offsets.begin();
+}
+
+void wordnet::load_data(const std::string & path)
+{
+    // pointer targets are resolved to ids once all synsets are known
+    struct raw_pointer
+    {
+        int pos;
+        std::uint32_t offset;
+    };
+    std::vector<raw_pointer> targets;
+
+    for (int pos = 1; pos < 5; pos++)
+    {
+        pos_begin[pos] = synsets.size();
+        std::string filename = path + "/data." + pos_names[pos];
+        std::ifstream file(filename);
+        if (!file)
+            throw std::runtime_error("couldn't read file: "+filename);
+
+        std::string line;
+        while (std::getline(file, line))
+        {
+            // skip the license header
+            if (line.empty() || line[0] == ' ')
+                continue;
+
+            std::istringstream ss(line);
+            std::uint32_t offset;
+            std::string lex_filenum, ss_type, token;
+            unsigned int w_cnt, p_cnt;
+            ss >> offset >> lex_filenum >> ss_type >> std::hex >> w_cnt >> std::dec;
+
+            synset row;
+            row.words_begin = word_offsets.size();
+            row.words_count = w_cnt;
+            for (unsigned int i = 0; i < w_cnt; i++)
+            {
+                std::string lex_id;
+                ss >> token >> lex_id;
+                // strip adjective markers: (a), (p), (ip)
+                if (pos == 3 && token.find('(') != std::string::npos)
+                    token.erase(token.find('('));
+                word_offsets.push_back(words.size());
+                words += token;
+                words.push_back('\0');
+            }
+
+            ss >> p_cnt;
+            row.pointers_begin = pointers.size();
+            row.pointers_count = p_cnt;
+            for (unsigned int i = 0; i < p_cnt; i++)
+            {
+                std::string symbol, target_pos, source_target;
+                std::uint32_t target;
+                ss >> symbol >> target >> target_pos >> source_target;
+                pointers.push_back({0, relation_of(symbol)});
+                targets.push_back({pos_of(target_pos[0]), target});
+            }
+
+            if (!ss)
+                throw std::runtime_error("couldn't parse `"+filename+"` at offset "
+                                         +std::to_string(offset));
+
+            synsets.push_back(row);
+            synset_offsets.push_back(offset);
+        }
+    }
+    pos_begin[5] = synsets.size();
+
+    for (unsigned int i = 0; i < pointers.size(); i++)
+        pointers[i].target = synset_id(targets[i].pos, targets[i].offset);
+}
+
+void wordnet::load_index(const std::string & path)
+{
+    for (int pos = 1; pos < 5; pos++)
+    {
+        std::string filename = path + "/index." + pos_names[pos];
+        std::ifstream file(filename);
+        if (!file)
+            throw std::runtime_error("couldn't read file: "+filename);
+
+        std::vector<std::string> entries;
+        std::string line;
+        while (std::getline(file, line))
+        {
+            // skip the license header
+            if (line.empty() || line[0] == ' ')
+                continue;
+
+            std::istringstream ss(line);
+            std::string lemma, lex, symbol;
+            unsigned int synset_cnt, p_cnt, sense_cnt, tagsense_cnt;
+            ss >> lemma >> lex >> synset_cnt >> p_cnt;
+            for (unsigned int i = 0; i < p_cnt; i++)
+                ss >> symbol;
+            ss >> sense_cnt >> tagsense_cnt;
+
+            senses_begin[pos].push_back(senses[pos].size());
+            for (unsigned int i = 0; i < synset_cnt; i++)
+            {
+                std::uint32_t offset;
+                ss >> offset;
+                senses[pos].push_back(synset_id(pos, offset));
+            }
+
+            if (!ss)
+                throw std::runtime_error("couldn't parse `"+filename+"` at `"+lemma+"`");
+
+            entries.push_back(lemma);
+        }
+        senses_begin[pos].push_back(senses[pos].size());
+        lemmas[pos].build(entries);
+    }
+}
+
+void wordnet::load_exceptions(const std::string & path)
+{
+    for (int pos = 1; pos < 5; pos++)
+    {
+        std::string filename = path + "/" + pos_names[pos] + ".exc";
+        std::ifstream file(filename);
+        if (!file)
+            throw std::runtime_error("couldn't read file: "+filename);
+
+        // `inflection base [base ...]` - keep the first base form
+        std::string line, inflection, base;
+        while (std::getline(file, line))
+        {
+            std::istringstream ss(line);
+            if (ss >> inflection >> base)
+                exceptions[pos].emplace(inflection, base);
+        }
+    }
+}
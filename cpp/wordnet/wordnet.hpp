@@ -0,0 +1,140 @@
+#ifndef NLP_ENCODER_WORDNET
+#define NLP_ENCODER_WORDNET
+#include "includes.ihh"
+///
+/// WordNet pointer (relation) types kept by the store
+///
+enum class relation : std::uint8_t
+{
+    hypernym,
+    instance_hypernym,
+    hyponym,
+    instance_hyponym,
+    other
+};
+///
+/// a pointer to another synset (by synset id)
+///
+struct pointer
+{
+    std::uint32_t target;
+    relation type;
+};
+///
+/// a synset - its words and pointers are ranges in the store's flat arrays
+///
+struct synset
+{
+    std::uint32_t words_begin;
+    std::uint16_t words_count;
+    std::uint32_t pointers_begin;
+    std::uint16_t pointers_count;
+};
+///
+/// perfect hash index of the lemmas of one part of speech (hash and displace):
+/// lemmas are hashed into buckets, and each bucket gets the first seed which sends
+/// all of its lemmas to free slots - a lookup is two hashes and one string compare
+///
+struct lemma_index
+{
+    /// build the index - entry `i` is @param lemmas[i]
+    void build(const std::vector<std::string> & lemmas);
+
+    /// @return the entry of @param lemma or -1 if it isn't indexed
+    int find(const std::string & lemma) const;
+
+    // lemmas, each followed by '\0'
+    std::string arena;
+    // arena offset of each entry
+    std::vector<std::uint32_t> offsets;
+    // displacement seed of each bucket
+    std::vector<std::uint32_t> seeds;
+    // entry of each slot, -1 if free
+    std::vector<std::int32_t> slots;
+};
+///
+/// In-memory WordNet 3.0: the dict files (index.*, data.*, *.exc) are read once
+/// into flat tables. Nothing is mutated after loading, so all queries are thread-safe.
+/// Parts of speech are WordNet lexicals: 1 NOUN, 2 VERB, 3 ADJECTIVE, 4 ADVERB
+///
+class wordnet
+{
+public:
+
+    /// the store loaded from `$WNSEARCHDIR` (or the default WordNet-3.0 dict directory)
+    static const wordnet & singleton();
+
+    /// load the dict files found in @param path
+    explicit wordnet(const std::string & path);
+
+    /// No Copying allowed
+    wordnet(const wordnet &) = delete;
+
+    // No assignment Allowed
+    wordnet& operator=(const wordnet &) = delete;
+
+    /// is @param lemma indexed for @param pos
+    bool exists(const std::string & lemma, int pos) const;
+
+    /// the base form of @param token: itself if it's a lemma, else exception lists, then suffix rules
+    /// @return the lower-case token if no base form is found
+    std::string lemmatise(const std::string & token, int pos) const;
+
+    /// the synset id of the first sense of @param lemma, or -1 if it isn't indexed
+    std::int64_t first_synset(const std::string & lemma, int pos) const;
+
+    /// synset by id
+    const synset & at(std::uint32_t id) const
+    {
+        return synsets[id];
+    }
+
+    /// the i-th word of a synset
+    const char * word(const synset & arg, unsigned int i) const
+    {
+        return words.c_str() + word_offsets[arg.words_begin + i];
+    }
+
+    /// the i-th pointer of a synset
+    const pointer & link(const synset & arg, unsigned int i) const
+    {
+        return pointers[arg.pointers_begin + i];
+    }
+
+private:
+
+    /// read data.{noun,verb,adj,adv} into `synsets`, `words` and `pointers`
+    void load_data(const std::string & path);
+
+    /// read index.{noun,verb,adj,adv} into `lemmas` and `senses`
+    void load_index(const std::string & path);
+
+    /// read {noun,verb,adj,adv}.exc into `exceptions`
+    void load_exceptions(const std::string & path);
+
+    /// synset id of the synset at @param offset of the @param pos data file
+    std::uint32_t synset_id(int pos, std::uint32_t offset) const;
+
+    /// This class signleton instance
+    static std::unique_ptr<wordnet> __singleton;
+
+    // all synsets, grouped by part of speech in file order
+    std::vector<synset> synsets;
+    // data file offset of each synset (ascending within each part of speech)
+    std::vector<std::uint32_t> synset_offsets;
+    // first synset id of each part of speech (index 5 is the end)
+    std::uint32_t pos_begin[6] = {0, 0, 0, 0, 0, 0};
+    // synset words, each followed by '\0'
+    std::string words;
+    std::vector<std::uint32_t> word_offsets;
+    // synset pointers
+    std::vector<pointer> pointers;
+    // lemma index for each part of speech
+    lemma_index lemmas[5];
+    // synset ids of each lemma entry, in sense order: entry `i` is [senses_begin[i], senses_begin[i+1])
+    std::vector<std::uint32_t> senses_begin[5];
+    std::vector<std::uint32_t> senses[5];
+    // irregular inflection to base form
+    std::unordered_map<std::string, std::string> exceptions[5];
+};
+#endif
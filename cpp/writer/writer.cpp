@@ -0,0 +1,244 @@
+#include "writer.hpp"
+
+/// print the digits of @param value into @param out, @return the end of the digits
+static char * digits(char * out, std::uint64_t value)
+{
+    char reversed[20];
+    int count = 0;
+    do
+    {
+        reversed[count++] = '0' + (value % 10);
+        value /= 10;
+    }
+    while (value > 0);
+
+    while (count > 0)
+        *out++ = reversed[--count];
+    return out;
+}
+
+writer::writer(
+                const std::string & filename,
+                output format,
+                std::size_t capacity,
+                dtype values
+              )
+: file(filename, std::ios::binary), format_type(format), values_type(values), buffer(capacity)
+{
+    if (!file)
+        throw std::runtime_error("couldn't write to file `"+filename+"`");
+
+    if (format_type != output::binary && values_type != dtype::float32)
+        throw std::runtime_error("only binary output has reduced precision");
+
+    if (format_type == output::binary && values_type == dtype::float32)
+        put("WVB1", 4);
+    else if (format_type == output::binary)
+    {
+        std::uint32_t type = static_cast<std::uint32_t>(values_type);
+        put("WVB2", 4);
+        put(reinterpret_cast<const char*>(&type), sizeof(type));
+    }
+}
+
+writer::~writer()
+{
+    // destructors mustn't throw: errors surface on an explicit `flush`
+    try { flush(); } catch (...) {}
+}
+
+void writer::flush()
+{
+    if (used > 0)
+    {
+        file.write(buffer.data(), used);
+        used = 0;
+    }
+    file.flush();
+    if (!file)
+        throw std::runtime_error("failed writing review vectors");
+}
+
+/// @return 10 to the power of @param exponent, in [-32, 56]
+static double power_of_ten(int exponent)
+{
+    static const std::vector<double> powers = []
+    {
+        std::vector<double> result;
+        for (int k = -32; k <= 56; k++)
+            result.push_back(std::pow(10.0, k));
+        return result;
+    }();
+    return powers[exponent + 32];
+}
+
+char * writer::format(char * out, float value)
+{
+    if (!std::isfinite(value))
+        return out + std::snprintf(out, 32, "%g", value);
+
+    if (value == 0.f)
+    {
+        *out++ = '0';
+        return out;
+    }
+    if (value < 0.f)
+    {
+        *out++ = '-';
+        value = -value;
+    }
+
+    // the 9 leading digits, as an integer in [1e8, 1e9), ties rounded to even
+    double magnitude = value;
+    int exponent = int(std::floor(std::log10(magnitude)));
+    auto leading_digits = [&]
+    {
+        double scaled = magnitude * power_of_ten(8 - exponent);
+        double integral = std::floor(scaled);
+        std::uint64_t result = std::uint64_t(integral);
+        if (scaled - integral > 0.5 || (scaled - integral == 0.5 && (result & 1)))
+            result++;
+        return result;
+    };
+    std::uint64_t leading = leading_digits();
+    if (leading >= 1000000000ULL)
+    {
+        exponent++;
+        leading = leading_digits();
+    }
+    else if (leading < 100000000ULL)
+    {
+        exponent--;
+        leading = leading_digits();
+    }
+
+    char figures[9];
+    int count = 9;
+    for (int i = 8; i >= 0; i--, leading /= 10)
+        figures[i] = '0' + (leading % 10);
+    while (count > 1 && figures[count - 1] == '0')
+        count--;
+
+    if (exponent >= -4 && exponent < 9)
+    {
+        if (exponent < 0)
+        {
+            *out++ = '0';
+            *out++ = '.';
+            for (int i = -1; i > exponent; i--)
+                *out++ = '0';
+            return std::copy(figures, figures + count, out);
+        }
+        // integral figures, padded with zeros, then the fraction if any
+        for (int i = 0; i <= exponent; i++)
+            *out++ = i < count ? figures[i] : '0';
+        if (count > exponent + 1)
+        {
+            *out++ = '.';
+            out = std::copy(figures + exponent + 1, figures + count, out);
+        }
+        return out;
+    }
+
+    *out++ = figures[0];
+    if (count > 1)
+    {
+        *out++ = '.';
+        out = std::copy(figures + 1, figures + count, out);
+    }
+    *out++ = 'e';
+    *out++ = exponent < 0 ? '-' : '+';
+    int absolute = std::abs(exponent);
+    if (absolute < 10)
+        *out++ = '0';
+    return digits(out, absolute);
+}
+
+void writer::put_unsigned(std::uint64_t value)
+{
+    reserve(20);
+    used = digits(&buffer[used], value) - &buffer[0];
+}
+
+void writer::put_json(const std::string & text)
+{
+    put("\"", 1);
+    for (unsigned char c : text)
+    {
+        switch (c)
+        {
+            case '"':  put("\\\"", 2); break;
+            case '\\': put("\\\\", 2); break;
+            case '\n': put("\\n", 2);  break;
+            case '\r': put("\\r", 2);  break;
+            case '\t': put("\\t", 2);  break;
+            default:
+                if (c < 0x20)
+                {
+                    char escaped[7];
+                    std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+                    put(escaped, 6);
+                }
+                else
+                {
+                    reserve(1);
+                    buffer[used++] = c;
+                }
+        }
+    }
+    put("\"", 1);
+}
+
+void writer::write(const std::string & text, float score, const thrust::host_vector<float> & vector)
+{
+    switch (format_type)
+    {
+        case output::json_lines:
+        {
+            put("{\"text\":", 8);
+            put_json(text);
+            put(",\"score\":", 9);
+            put_json(score);
+            put(",\"vector\":[", 11);
+            for (std::size_t k = 0; k < vector.size(); k++)
+            {
+                if (k > 0)
+                    put(",", 1);
+                put_json(vector[k]);
+            }
+            put("]}\n", 3);
+            break;
+        }
+        case output::libsvm:
+        {
+            put(score);
+            for (std::size_t k = 0; k < vector.size(); k++)
+            {
+                if (vector[k] != 0.f)
+                {
+                    put(" ", 1);
+                    put_unsigned(k + 1);
+                    put(":", 1);
+                    put(vector[k]);
+                }
+            }
+            put("\n", 1);
+            break;
+        }
+        case output::binary:
+        {
+            std::uint32_t length = vector.size();
+            put(reinterpret_cast<const char*>(&score), sizeof(float));
+            put(reinterpret_cast<const char*>(&length), sizeof(length));
+            if (length > 0)
+            {
+                // narrow straight into the buffer
+                std::size_t bytes = length * size_of(values_type);
+                reserve(bytes);
+                narrow(&vector[0], length, values_type, &buffer[used]);
+                used += bytes;
+            }
+            break;
+        }
+    }
+}
@@ -0,0 +1,116 @@
+#ifndef NLP_ENCODER_WRITER
+#define NLP_ENCODER_WRITER
+#include "includes.ihh"
+///
+/// output formats of `writer`
+///
+enum class output
+{
+    json_lines, // one {"text", "score", "vector"} object per line
+    libsvm,     // `score index:value ...` per line, non-zero values, indices from 1
+    binary      // "WVB1" then per review: float score, uint32 length, `length` floats (native endian);
+                // "WVB2" and a uint32 `dtype` then the same, values narrowed to `dtype`
+};
+///
+/// streams review vectors to a file through a fixed buffer, without
+/// building the whole output in memory. Floats are printed with 9 significant
+/// digits, which read back to the same float, by integer arithmetic rather than stdio
+///
+class writer
+{
+public:
+
+    /// @param values narrows binary output, text formats only print float32
+    writer(
+            const std::string & filename,
+            output format,
+            std::size_t capacity = 1 << 20,
+            dtype values = dtype::float32
+          );
+
+    /// flush and close
+    ~writer();
+
+    /// No Copying allowed
+    writer(const writer &) = delete;
+
+    // No assignment Allowed
+    writer& operator=(const writer &) = delete;
+
+    /// write one review
+    void write(const data & review)
+    {
+        write(review.review, review.score, review.vector);
+    }
+
+    /// write the reviews of @param dataset
+    void write(const std::vector<data> & dataset)
+    {
+        for (const data & review : dataset)
+            write(review);
+    }
+
+    /// write the @param reviews of @param arg
+    void write(const corpus & arg, const corpus::view & reviews)
+    {
+        for (std::uint32_t i : reviews.indices)
+            write(arg.review(i), arg.scores[i], arg.vectors[i]);
+    }
+
+    /// write the buffered output to the file
+    void flush();
+
+    /// format @param value into @param out (at least 32 chars): 9 significant digits,
+    /// trailing zeros dropped, exponent notation outside [1e-4, 1e9) as `%.9g` does
+    /// @return the end of the written chars
+    static char * format(char * out, float value);
+
+private:
+
+    void write(const std::string & text, float score, const thrust::host_vector<float> & vector);
+
+    /// make room for @param size more bytes
+    inline void reserve(std::size_t size)
+    {
+        if (used + size > buffer.size())
+        {
+            flush();
+            if (size > buffer.size())
+                buffer.resize(size);
+        }
+    }
+
+    inline void put(const char * data, std::size_t size)
+    {
+        reserve(size);
+        std::memcpy(&buffer[used], data, size);
+        used += size;
+    }
+
+    inline void put(float value)
+    {
+        reserve(32);
+        used = format(&buffer[used], value) - &buffer[0];
+    }
+
+    /// json has no NaN or infinity: they are written as `null`
+    inline void put_json(float value)
+    {
+        if (std::isfinite(value))
+            put(value);
+        else
+            put("null", 4);
+    }
+
+    void put_unsigned(std::uint64_t value);
+
+    /// json string of @param text, quoted and escaped
+    void put_json(const std::string & text);
+
+    std::ofstream file;
+    const output format_type;
+    const dtype values_type;
+    std::vector<char> buffer;
+    std::size_t used = 0;
+};
+#endif
@@ -11,14 +11,39 @@ var argv = require('yargs')
     .describe('filter', 'ignore reviews with more words than the filter value')
     .describe('x', 'encodable words thershold X')
     .describe('y', 'non-encodable words thershold Y')
+    .boolean('text')
+    .describe('text', 'the dataset is newline-delimited review text, not json')
+    .describe('format', 'write the vectors natively as `jsonl`, `libsvm`, `binary` or `wvc` (see container.js)')
+    .describe('dtype', 'with --format binary or wvc, store values as `float32`, `float16` or `uint8`')
+    .describe('layout', 'with --format wvc, store vectors as `csr` (default) or `dense` rows')
+    .check(function (argv)
+    {
+        if (argv.dtype && argv.format !== 'binary' && argv.format !== 'wvc')
+            throw new Error('--dtype needs --format binary or wvc');
+        if (argv.layout && argv.format !== 'wvc')
+            throw new Error('--layout needs --format wvc');
+        return true;
+    })
     .argv;
 
 console.log('dataset: '+argv.d+' filter: '+argv.f+
             ' X threshold: '+argv.x+' Y threshold: '+argv.y);
 
-// parse the json dataset
-var json = JSON.parse(require('fs').readFileSync(argv.d, 'utf8'));
-if (json)
+// parse the json dataset, or hand the raw text over as a Buffer
+var json = argv.text ? {text: fs.readFileSync(argv.d)}
+                     : JSON.parse(fs.readFileSync(argv.d, 'utf8'));
+if (json && argv.format)
+{
+    // vectors are streamed to disk by the addon, never built as js arrays
+    if (argv.dtype)
+        json.dtype = argv.dtype;
+    if (argv.layout)
+        json.layout = argv.layout;
+    var output = 'sparse_vector_f'+argv.f+'_x'+argv.x+'_y'+argv.y+'.'+argv.format;
+    var res = wv.compress_to_file(json, argv.f, argv.x, argv.y, output, argv.format);
+    console.log('wrote '+res.count+' reviews to '+output);
+}
+else if (json)
 {
     var res = wv.compress_sparse(json, argv.f, argv.x, argv.y);
     if (res)
@@ -1,111 +1,260 @@
 #include <iostream>
 #include <sstream>
+#include <iterator>
+#include <chrono>
+#include <cstring>
 
 #include <node.h>
 #include <v8.h>
+#include <node_object_wrap.h>
+#include <node_buffer.h>
 
+#include "cpp/parser/parser.hpp"
 #include "cpp/tokenizer/tokenizer.hpp"
 #include "cpp/miner/miner.hpp"
 #include "cpp/principals/principals.hpp"
 #include "cpp/semantics/semantics.hpp"
 #include "cpp/compressor/compressor.hpp"
+#include "cpp/pipeline/pipeline.hpp"
+#include "cpp/encoder/encoder.hpp"
+#include "cpp/histogram/histogram.hpp"
+#include "cpp/writer/writer.hpp"
+#include "cpp/container/container.hpp"
+#include "cpp/precision/precision.hpp"
 
 #include <boost/property_tree/json_parser.hpp>
 #include <boost/property_tree/ptree.hpp>
 
 using namespace v8;
 
-data unpack_data(Isolate * isolate, const Handle<Object> row)
+// parse the newline-delimited reviews of a `text` Buffer straight from its memory
+// into a corpus, scored by the optional `scores` Float32Array (one per line)
+corpus unpack_text(Isolate * isolate, const Handle<Object> input, const Handle<Value> text)
 {
-    data d;
-    Handle<Value> text_value = row->Get(String::NewFromUtf8(isolate, "data"));
-    Handle<Value> score_value = row->Get(String::NewFromUtf8(isolate, "score"));
-    v8::String::Utf8Value utfValue(text_value);
-    d.review = std::string(*utfValue);
-    d.score = score_value->NumberValue();
-    return std::move(d);
+    Handle<Value> scores = input->Get(String::NewFromUtf8(isolate, "scores"));
+    const float * score_data = nullptr;
+    std::size_t score_count = 0;
+    if (scores->IsFloat32Array())
+    {
+        Handle<Float32Array> array = Handle<Float32Array>::Cast(scores);
+        score_data = reinterpret_cast<const float*>(
+                        static_cast<const char*>(array->Buffer()->GetContents().Data())
+                        + array->ByteOffset());
+        score_count = array->Length();
+    }
+    else if (!scores->IsUndefined())
+        throw std::runtime_error("`scores` must be a Float32Array");
+
+    corpus result;
+    parser().lines(node::Buffer::Data(text), node::Buffer::Length(text),
+                   result, score_data, score_count);
+    return result;
 }
 
-// get the JSON data and parse it into our dataset
-std::vector<data> unpack_json(Isolate * isolate, const v8::FunctionCallbackInfo<v8::Value> &args)
+// get the JSON data as a corpus: either {dataset: [{data, score}, ...]}, whose rows are
+// appended to its arena one at a time, or {text: Buffer[, scores: Float32Array]},
+// parsed straight into it
+corpus unpack_corpus(Isolate * isolate, const v8::FunctionCallbackInfo<v8::Value> &args)
 {
-    std::vector<data> json_data;
     Handle<Object> dataset = Handle<Object>::Cast(args[0]);
+    Handle<Value> text = dataset->Get(String::NewFromUtf8(isolate, "text"));
+    if (node::Buffer::HasInstance(text))
+        return unpack_text(isolate, dataset, text);
+
+    corpus result;
     Handle<Array> array = Handle<Array>::Cast(dataset->Get(String::NewFromUtf8(isolate, "dataset")));
-    int data_len = array->Length();
-    for (int i = 0; i < data_len; i++)
+    Handle<String> data_key = String::NewFromUtf8(isolate, "data");
+    Handle<String> score_key = String::NewFromUtf8(isolate, "score");
+    for (unsigned int i = 0; i < array->Length(); i++)
     {
-        data row = unpack_data(isolate, Handle<Object>::Cast(array->Get(i)));
-        json_data.push_back(row);
+        Handle<Object> row = Handle<Object>::Cast(array->Get(i));
+        v8::String::Utf8Value review(row->Get(data_key));
+        result.push_back(*review, *review + review.length(), row->Get(score_key)->NumberValue());
     }
-    return json_data;
+    return result;
 }
 
-// pack the dataset and allocate it on the v8 heap
-Local<Array> pack(Isolate * isolate, std::vector<data> & dataset)
+// pack the @param reviews of @param arg (text, score and vector) on the v8 heap
+Local<Array> pack(Isolate * isolate, const corpus & arg, const corpus::view & reviews)
 {
     // array of data
     Local<Array> result = Array::New(isolate);
+    Handle<String> text_key = String::NewFromUtf8(isolate, "text");
+    Handle<String> score_key = String::NewFromUtf8(isolate, "score");
+    Handle<String> vector_key = String::NewFromUtf8(isolate, "vector");
     // populate
-    for (unsigned int i = 0; i < dataset.size(); i++)
+    for (unsigned int k = 0; k < reviews.size(); k++)
+    {
+        std::uint32_t i = reviews[k];
+        Local<Object> obj = Object::New(isolate);
+        // set object text and score
+        obj->Set(text_key, String::NewFromUtf8(isolate, arg.review(i).c_str()));
+        obj->Set(score_key, Number::New(isolate, arg.scores[i]));
+        // populate the v8 array (copy)
+        Local<Array> vec = Array::New(isolate);
+        for (unsigned int v = 0; v < arg.vectors[i].size(); v++)
+            vec->Set(v, Number::New(isolate, arg.vectors[i][v]));
+        obj->Set(vector_key, vec);
+        result->Set(k, obj);
+    }
+    return result;
+}
+
+// pack a principal vocabulary (by column) as an array of {token, tag}
+Local<Array> pack(Isolate * isolate, const vocabulary & keys)
+{
+    Local<Array> result = Array::New(isolate);
+    for (unsigned int i = 0; i < keys.size(); i++)
+    {
+        Local<Object> obj = Object::New(isolate);
+        obj->Set(String::NewFromUtf8(isolate, "token"),
+                 String::NewFromUtf8(isolate, keys.words[i].token().c_str()));
+        obj->Set(String::NewFromUtf8(isolate, "tag"),
+                 String::NewFromUtf8(isolate, keys.words[i].tag().c_str()));
+        result->Set(i, obj);
+    }
+    return result;
+}
+
+// pack a row table as {width, columns, rows, dataset}: each review's `refs` is a flat
+// array of (position, row) pairs into the shared `rows`
+Local<Object> pack(Isolate * isolate, const row_table & table, const corpus & arg, const corpus::view & reviews)
+{
+    Local<Object> result = Object::New(isolate);
+    result->Set(String::NewFromUtf8(isolate, "width"), Number::New(isolate, table.width));
+    result->Set(String::NewFromUtf8(isolate, "columns"), Number::New(isolate, table.columns));
+    Local<Array> rows = Array::New(isolate);
+    for (unsigned int i = 0; i < table.rows.size(); i++)
+    {
+        Local<Array> row = Array::New(isolate);
+        for (unsigned int k = 0; k < table.rows[i].size(); k++)
+            row->Set(k, Number::New(isolate, table.rows[i][k]));
+        rows->Set(i, row);
+    }
+    result->Set(String::NewFromUtf8(isolate, "rows"), rows);
+    Local<Array> packed = Array::New(isolate);
+    for (unsigned int i = 0; i < table.size(); i++)
     {
         Local<Object> obj = Object::New(isolate);
-        // set object text
         obj->Set(String::NewFromUtf8(isolate, "text"),
-                 String::NewFromUtf8(isolate, dataset[i].review.c_str()));
-        // set object score
+                 String::NewFromUtf8(isolate, arg.review(reviews[i]).c_str()));
         obj->Set(String::NewFromUtf8(isolate, "score"),
-                 Number::New(isolate, dataset[i].score));
-        // allocate an array, set size
-        Local<Array> vec = Array::New(isolate);
-        // populate the v8 array (copy)
-        for (unsigned int k = 0; k < dataset[i].vector.size(); k++)
+                 Number::New(isolate, arg.scores[reviews[i]]));
+        Local<Array> refs = Array::New(isolate);
+        unsigned int k = 0;
+        for (const row_ref & ref : table.review(i))
         {
-            vec->Set(k, Number::New(isolate, dataset[i].vector[k]));
+            refs->Set(k++, Number::New(isolate, ref.position));
+            refs->Set(k++, Number::New(isolate, ref.row));
         }
-        obj->Set(String::NewFromUtf8(isolate, "vector"), vec);
-        result->Set(i, obj);
+        obj->Set(String::NewFromUtf8(isolate, "refs"), refs);
+        packed->Set(i, obj);
     }
-    return std::move(result);
+    result->Set(String::NewFromUtf8(isolate, "dataset"), packed);
+    return result;
+}
+
+// principal budget of the optional `budget` member of the json data @param json:
+// {encodable: n, non_encodable: m} keeps at most the n (m) most frequent principals,
+// {approximate: c} estimates frequencies with `c` words per sketch instead of counting all words
+budget unpack_budget(Isolate * isolate, const Handle<Value> json)
+{
+    budget result;
+    Handle<Value> value = Handle<Object>::Cast(json)->Get(String::NewFromUtf8(isolate, "budget"));
+    if (value->IsObject())
+    {
+        Handle<Object> limits = Handle<Object>::Cast(value);
+        Handle<Value> encodable = limits->Get(String::NewFromUtf8(isolate, "encodable"));
+        Handle<Value> non_encodable = limits->Get(String::NewFromUtf8(isolate, "non_encodable"));
+        Handle<Value> approximate = limits->Get(String::NewFromUtf8(isolate, "approximate"));
+        if (encodable->IsNumber())
+            result.encodable = encodable->Uint32Value();
+        if (non_encodable->IsNumber())
+            result.non_encodable = non_encodable->Uint32Value();
+        if (approximate->IsNumber())
+            result.approximate = approximate->Uint32Value();
+    }
+    return result;
+}
+
+// hypernym/hyponym expansion depth of the optional `depth` member of the json data @param json,
+// zero (the default) expands the whole graphs
+unsigned int unpack_depth(Isolate * isolate, const Handle<Value> json)
+{
+    Handle<Value> value = Handle<Object>::Cast(json)->Get(String::NewFromUtf8(isolate, "depth"));
+    return value->IsNumber() ? value->Uint32Value() : 0;
 }
 
-//  argv[0]: the parsed json data
+// column policy of the optional `columns` member of the json data @param json:
+// {cap: n} truncates at n positions, {percentile: p} at the p-th (0, 1] length of
+// @param reviews (a dataset, or a corpus and view), {buckets: n} keeps n exact positions
+// then merges logarithmic buckets. Without one, every review has @param max_size columns
+template <class... Reviews>
+column_layout unpack_columns(
+                              Isolate * isolate,
+                              const Handle<Value> json,
+                              unsigned int max_size,
+                              const Reviews & ... reviews
+                            )
+{
+    Handle<Value> value = Handle<Object>::Cast(json)->Get(String::NewFromUtf8(isolate, "columns"));
+    if (!value->IsObject())
+        return column_layout(max_size);
+
+    Handle<Object> policy = Handle<Object>::Cast(value);
+    Handle<Value> cap = policy->Get(String::NewFromUtf8(isolate, "cap"));
+    Handle<Value> percentile = policy->Get(String::NewFromUtf8(isolate, "percentile"));
+    Handle<Value> buckets = policy->Get(String::NewFromUtf8(isolate, "buckets"));
+    if (cap->IsNumber())
+        return column_layout(std::min(max_size, cap->Uint32Value()));
+    if (percentile->IsNumber())
+        return column_layout::percentile(reviews..., percentile->NumberValue());
+    if (buckets->IsNumber())
+        return column_layout::log_buckets(max_size, buckets->Uint32Value());
+    throw std::runtime_error("unknown column policy");
+}
+
+// pack the principals of @param algo (a compressor or encoder) into @param result
+template <class T>
+void pack_principals(Isolate * isolate, const T & algo, Local<Object> result)
+{
+    result->Set(String::NewFromUtf8(isolate, "encodable"), pack(isolate, algo.encodable()));
+    result->Set(String::NewFromUtf8(isolate, "non_encodable"), pack(isolate, algo.non_encodable()));
+}
+
+//  argv[0]: the parsed json data or a `text` Buffer (@see `unpack_corpus`),
+//           with optional `columns` policy, principal `budget` and expansion `depth`
 //  argv[1]: filter the reviews above `filter` length
 //  argv[2]: encodable_threshold (int)
 //  argv[3]: non_encodable_thres (int)
-//  RETURN: ??
+//  argv[4]: (optional) encoding threads, all cores if omitted or zero
+//  RETURN: {encodable, non_encodable, dataset} - the principals of each position's 
+//          columns (encodable first), and the reviews with their vectors
 void compress_sparse(const v8::FunctionCallbackInfo<v8::Value>& args)
 {
     if (args.Length() > 0 && args.Length() < 6)
     {
         Isolate* isolate = args.GetIsolate();
         // unpack node data
-        std::vector<data> dataset = unpack_json(isolate, args);
+        corpus reviews = unpack_corpus(isolate, args);
+        corpus::view selected = reviews.all();
         // get params
         unsigned int f = args[1]->Uint32Value();
         unsigned int x = args[2]->Uint32Value();
         unsigned int y = args[3]->Uint32Value();
-        // load tokenizer
-        tokenizer tkr;
-        // POS tag
-        tkr(dataset);
-        // filter
-        dataset = tkr.filter(dataset, f); 
-        unsigned int max_size = tkr.max_size(dataset);
-        // semantics
-        semantics sema_blob = semantics(dataset);
-        std::vector<triplet> known_stats = miner()(dataset, sema_blob.known_words);
-        std::unordered_set<word> enc_principals = principals()(known_stats, x);
-        std::vector<triplet> unknown_stats = miner()(dataset, sema_blob.unknown_words);
-        std::unordered_set<word> sym_principals = principals()(unknown_stats, y);
-        // compress
-        compressor algo(sema_blob, enc_principals, sym_principals);
+        unsigned int threads = args.Length() > 4 ? args[4]->Uint32Value() : 0;
+        // tag, filter, semantics and principals
+        pipeline blob(reviews, selected, f, x, y, threads, unpack_budget(isolate, args[0]),
+                      unpack_depth(isolate, args[0]));
 
         // compressed sparse (best delta) vector - WARNING: take care with last param!!!
         // setting to `false` will return a dense vector
-        algo.compressed_data(dataset, max_size, true);
+        column_layout columns = unpack_columns(isolate, args[0], blob.max_size, reviews, selected);
+        blob.algo.compressed_data(reviews, selected, columns, true, threads);
         // pack and allocate
-        Local<Array> result = pack(isolate, dataset);
+        Local<Object> result = Object::New(isolate);
+        pack_principals(isolate, blob.algo, result);
+        result->Set(String::NewFromUtf8(isolate, "dataset"), pack(isolate, reviews, selected));
         // return it
         args.GetReturnValue().Set(result);
     }
@@ -113,30 +262,703 @@ void compress_sparse(const v8::FunctionCallbackInfo<v8::Value>& args)
         throw std::runtime_error("illegal params");
 }
 
-//  TODO: return a compressed dense vector (all delta)
+// reviews encoded (and released) at a time by `compress_dense`
+const unsigned int dense_chunk = 1024;
+
+//  argv[0]: the parsed json data or a `text` Buffer (@see `unpack_corpus`),
+//           with optional `columns` policy, principal `budget` and expansion `depth`
+//  argv[1]: filter the reviews above `filter` length
+//  argv[2]: encodable_threshold (int)
+//  argv[3]: non_encodable_thres (int)
+//  argv[4]: (optional) encoding threads, all cores if omitted or zero
+//  argv[5]: (optional) callback, called with each chunk (array) of encoded reviews,
+//           encoding stops if it throws
+//  RETURN: {encodable, non_encodable, dataset} - as `compress_sparse`, but each word
+//          holds its deltas to all encodable principals. `dataset` is empty with a callback
+//  @note only the callback (or `compress_to_file`) keeps memory bounded: without one,
+//        `dataset` holds every dense vector at once
 void compress_dense(const v8::FunctionCallbackInfo<v8::Value>& args)
 {
-    // TODO: populate a dense vector
-    /*
-        tokenizer tkr;
-        tkr(dataset);
-        dataset = tkr.filter(dataset, filter); 
-        unsigned int max_size = tkr.max_size(dataset);
-        semantics sema_blob = semantics(dataset);
-        std::vector<triplet> known_stats = miner()(dataset, sema_blob.known_words);
-        std::unordered_set<word> enc_principals = principals()(known_stats, x);
-        std::vector<triplet> unknown_stats = miner()(dataset, sema_blob.unknown_words);
-        std::unordered_set<word> sym_principals = principals()(unknown_stats, y);
-        compressor algo(sema_blob, enc_principals, sym_principals);
-        algo.compressed_data(dataset, max_size, true);
-        //algo.uncompressed_data(dataset, max_size);
-    */
+    if (args.Length() > 0 && args.Length() < 7)
+    {
+        Isolate* isolate = args.GetIsolate();
+        // unpack node data
+        corpus reviews = unpack_corpus(isolate, args);
+        corpus::view selected = reviews.all();
+        // get params
+        unsigned int f = args[1]->Uint32Value();
+        unsigned int x = args[2]->Uint32Value();
+        unsigned int y = args[3]->Uint32Value();
+        unsigned int threads = args.Length() > 4 ? args[4]->Uint32Value() : 0;
+        bool stream = args.Length() > 5 && args[5]->IsFunction();
+        // tag, filter, semantics and principals
+        pipeline blob(reviews, selected, f, x, y, threads, unpack_budget(isolate, args[0]),
+                      unpack_depth(isolate, args[0]));
+
+        // each principal's all-delta row is calculated once and shared by all reviews
+        blob.algo.prepare_dense(threads);
+
+        column_layout columns = unpack_columns(isolate, args[0], blob.max_size, reviews, selected);
+        // encode, pack and release a chunk at a time
+        Local<Array> packed = Array::New(isolate);
+        unsigned int count = 0;
+        for (std::size_t begin = 0; begin < selected.size(); begin += dense_chunk)
+        {
+            std::size_t end = std::min<std::size_t>(selected.size(), begin + dense_chunk);
+            corpus::view chunk;
+            chunk.indices.assign(selected.indices.begin() + begin, selected.indices.begin() + end);
+            blob.algo.compressed_data(reviews, chunk, columns, false, threads);
+            Local<Array> items = pack(isolate, reviews, chunk);
+            for (std::uint32_t i : chunk.indices)
+                thrust::host_vector<float>().swap(reviews.vectors[i]);
+
+            if (stream)
+            {
+                Local<Value> argv[1] = {items};
+                // empty if the callback threw: leave its exception pending
+                if (Local<Function>::Cast(args[5])->Call(Null(isolate), 1, argv).IsEmpty())
+                    return;
+            }
+            else
+                for (unsigned int i = 0; i < items->Length(); i++)
+                    packed->Set(count++, items->Get(i));
+        }
+        Local<Object> result = Object::New(isolate);
+        pack_principals(isolate, blob.algo, result);
+        result->Set(String::NewFromUtf8(isolate, "dataset"), packed);
+        args.GetReturnValue().Set(result);
+    }
+    else
+        throw std::runtime_error("illegal params");
+}
+
+//  argv[0]: the parsed json data or a `text` Buffer (@see `unpack_corpus`),
+//           with optional `columns` policy, principal `budget` and expansion `depth`
+//  argv[1]: filter the reviews above `filter` length
+//  argv[2]: encodable_threshold (int)
+//  argv[3]: non_encodable_thres (int)
+//  argv[4]: (optional) sparse (true, default) or dense (false) rows
+//  argv[5]: (optional) encoding threads, all cores if omitted or zero
+//  RETURN: {encodable, non_encodable, width, columns, rows, dataset} - distinct word rows
+//          are stored once in `rows`, reviews reference them by `refs` (position, row) pairs
+//          so review vector[position*width + k] = rows[row][k], zero elsewhere
+void compress_table(const v8::FunctionCallbackInfo<v8::Value>& args)
+{
+    if (args.Length() > 0 && args.Length() < 7)
+    {
+        Isolate* isolate = args.GetIsolate();
+        // unpack node data
+        corpus reviews = unpack_corpus(isolate, args);
+        corpus::view selected = reviews.all();
+        // get params
+        unsigned int f = args[1]->Uint32Value();
+        unsigned int x = args[2]->Uint32Value();
+        unsigned int y = args[3]->Uint32Value();
+        bool sparse = args.Length() > 4 ? args[4]->BooleanValue() : true;
+        unsigned int threads = args.Length() > 5 ? args[5]->Uint32Value() : 0;
+        // tag, filter, semantics and principals
+        pipeline blob(reviews, selected, f, x, y, threads, unpack_budget(isolate, args[0]),
+                      unpack_depth(isolate, args[0]));
+
+        column_layout columns = unpack_columns(isolate, args[0], blob.max_size, reviews, selected);
+        row_table table = blob.algo.shared_data(reviews, selected, columns, sparse, threads);
+        Local<Object> result = pack(isolate, table, reviews, selected);
+        pack_principals(isolate, blob.algo, result);
+        args.GetReturnValue().Set(result);
+    }
+    else
+        throw std::runtime_error("illegal params");
 }
 
+// pooling mode by name: `sum`, `mean`, `max` or `tf`
+pooling pooling_of(const std::string & name)
+{
+    if (name == "sum")  return pooling::sum;
+    if (name == "mean") return pooling::mean;
+    if (name == "max")  return pooling::max;
+    if (name == "tf")   return pooling::tf;
+    throw std::runtime_error("unknown pooling `"+name+"`");
+}
+
+//  argv[0]: the parsed json data or a `text` Buffer (@see `unpack_corpus`),
+//           with an optional principal `budget` and expansion `depth`
+//  argv[1]: filter the reviews above `filter` length
+//  argv[2]: encodable_threshold (int)
+//  argv[3]: non_encodable_thres (int)
+//  argv[4]: pooling mode: `sum`, `mean`, `max` or `tf`
+//  argv[5]: (optional) sparse (true, default) or dense (false) word rows
+//  argv[6]: (optional) encoding threads, all cores if omitted or zero
+//  RETURN: {encodable, non_encodable, dataset} - each review's vector is one
+//          (encodable + non_encodable) wide pooled vector, whatever its length
+void compress_pooled(const v8::FunctionCallbackInfo<v8::Value>& args)
+{
+    if (args.Length() > 4 && args.Length() < 8)
+    {
+        Isolate* isolate = args.GetIsolate();
+        // unpack node data
+        corpus reviews = unpack_corpus(isolate, args);
+        corpus::view selected = reviews.all();
+        // get params
+        unsigned int f = args[1]->Uint32Value();
+        unsigned int x = args[2]->Uint32Value();
+        unsigned int y = args[3]->Uint32Value();
+        v8::String::Utf8Value mode(args[4]);
+        bool sparse = args.Length() > 5 ? args[5]->BooleanValue() : true;
+        unsigned int threads = args.Length() > 6 ? args[6]->Uint32Value() : 0;
+        // tag, filter, semantics and principals
+        pipeline blob(reviews, selected, f, x, y, threads, unpack_budget(isolate, args[0]),
+                      unpack_depth(isolate, args[0]));
+
+        blob.algo.pooled_data(reviews, selected, sparse, pooling_of(*mode), threads);
+        Local<Object> result = Object::New(isolate);
+        pack_principals(isolate, blob.algo, result);
+        result->Set(String::NewFromUtf8(isolate, "dataset"), pack(isolate, reviews, selected));
+        args.GetReturnValue().Set(result);
+    }
+    else
+        throw std::runtime_error("illegal params");
+}
+
+//  argv[0]: the parsed json data or a `text` Buffer (@see `unpack_corpus`),
+//           with optional `columns` policy, principal `budget` and expansion `depth`
+//  argv[1]: filter the reviews above `filter` length
+//  argv[2]: encodable_threshold (int)
+//  argv[3]: non_encodable_thres (int)
+//  argv[4]: file the fitted encoder is saved to, @see `transform`
+//  argv[5]: (optional) threads, all cores if omitted or zero
+//  RETURN: {encodable, non_encodable, max_size}
+void fit(const v8::FunctionCallbackInfo<v8::Value>& args)
+{
+    if (args.Length() > 4 && args.Length() < 7)
+    {
+        Isolate* isolate = args.GetIsolate();
+        // unpack node data
+        corpus reviews = unpack_corpus(isolate, args);
+        corpus::view selected = reviews.all();
+        // get params
+        unsigned int f = args[1]->Uint32Value();
+        unsigned int x = args[2]->Uint32Value();
+        unsigned int y = args[3]->Uint32Value();
+        v8::String::Utf8Value filename(args[4]);
+        unsigned int threads = args.Length() > 5 ? args[5]->Uint32Value() : 0;
+        // tag, filter, semantics and principals - as the compress calls
+        pipeline blob(reviews, selected, f, x, y, threads, unpack_budget(isolate, args[0]),
+                      unpack_depth(isolate, args[0]));
+
+        encoder fitted = encoder::fit(blob, threads);
+        fitted.reshape(unpack_columns(isolate, args[0], fitted.max_size(), reviews, selected));
+        fitted.save(*filename);
+
+        Local<Object> result = Object::New(isolate);
+        pack_principals(isolate, fitted, result);
+        result->Set(String::NewFromUtf8(isolate, "max_size"), Number::New(isolate, fitted.max_size()));
+        args.GetReturnValue().Set(result);
+    }
+    else
+        throw std::runtime_error("illegal params");
+}
+
+//  argv[0]: the parsed json data or a `text` Buffer (@see `unpack_corpus`)
+//  argv[1]: file of an encoder saved by `fit`
+//  argv[2]: (optional) sparse (true, default) or dense (false) vectors
+//  argv[3]: (optional) threads, all cores if omitted or zero
+//  RETURN: {dataset} - reviews above the fitted filter are dropped, the rest
+//          are encoded against the fitted principals and columns
+void transform(const v8::FunctionCallbackInfo<v8::Value>& args)
+{
+    if (args.Length() > 1 && args.Length() < 5)
+    {
+        Isolate* isolate = args.GetIsolate();
+        // unpack node data
+        corpus reviews = unpack_corpus(isolate, args);
+        corpus::view selected = reviews.all();
+        // get params
+        v8::String::Utf8Value filename(args[1]);
+        bool sparse = args.Length() > 2 ? args[2]->BooleanValue() : true;
+        unsigned int threads = args.Length() > 3 ? args[3]->Uint32Value() : 0;
+
+        encoder::load(*filename).transform(reviews, selected, sparse, threads);
+
+        Local<Object> result = Object::New(isolate);
+        result->Set(String::NewFromUtf8(isolate, "dataset"), pack(isolate, reviews, selected));
+        args.GetReturnValue().Set(result);
+    }
+    else
+        throw std::runtime_error("illegal params");
+}
+
+// copy @param values into a new typed array of type `T` (e.g. Float32Array)
+template <class T, class V>
+Local<T> pack_typed(Isolate * isolate, const std::vector<V> & values)
+{
+    Local<ArrayBuffer> buffer = ArrayBuffer::New(isolate, values.size() * sizeof(V));
+    if (!values.empty())
+        std::memcpy(buffer->GetContents().Data(), values.data(), values.size() * sizeof(V));
+    return T::New(buffer, 0, values.size());
+}
+
+// narrow @param values into a new typed array of @param type:
+// Float32Array, Uint16Array (float16 bits) or Uint8Array (1/255 steps)
+Local<TypedArray> pack_narrowed(Isolate * isolate, const std::vector<float> & values, dtype type)
+{
+    Local<ArrayBuffer> buffer = ArrayBuffer::New(isolate, values.size() * size_of(type));
+    narrow(values.data(), values.size(), type, buffer->GetContents().Data());
+    switch (type)
+    {
+        case dtype::float16: return Uint16Array::New(buffer, 0, values.size());
+        case dtype::uint8:   return Uint8Array::New(buffer, 0, values.size());
+        default:             return Float32Array::New(buffer, 0, values.size());
+    }
+}
+
+// value type of the optional `dtype` member of the json data @param json:
+// `float32` (default), `float16` or `uint8` (@see `dtype`)
+dtype unpack_dtype(Isolate * isolate, const Handle<Value> json)
+{
+    Handle<Value> value = Handle<Object>::Cast(json)->Get(String::NewFromUtf8(isolate, "dtype"));
+    if (!value->IsString())
+        return dtype::float32;
+
+    v8::String::Utf8Value name(value);
+    return dtype_of(*name);
+}
+
+// container layout of the optional `layout` member of the json data @param json:
+// `csr` (default) or `dense` rows (@see `container_writer`)
+bool unpack_csr(Isolate * isolate, const Handle<Value> json)
+{
+    Handle<Value> value = Handle<Object>::Cast(json)->Get(String::NewFromUtf8(isolate, "layout"));
+    if (!value->IsString())
+        return true;
+
+    v8::String::Utf8Value name(value);
+    std::string layout(*name);
+    if (layout != "csr" && layout != "dense")
+        throw std::runtime_error("unknown container layout `"+layout+"`");
+    return layout == "csr";
+}
+
+// output format by name: `jsonl`, `libsvm` or `binary`
+output output_of(const std::string & name)
+{
+    if (name == "jsonl")  return output::json_lines;
+    if (name == "libsvm") return output::libsvm;
+    if (name == "binary") return output::binary;
+    throw std::runtime_error("unknown output format `"+name+"`");
+}
+
+//  argv[0]: the parsed json data or a `text` Buffer (@see `unpack_corpus`),
+//           with optional `columns` policy, principal `budget`, expansion `depth`,
+//           value `dtype` (`float32`, `float16` or `uint8`, binary and `wvc` output only)
+//           and `layout` (`csr` or `dense`, `wvc` output only)
+//  argv[1]: filter the reviews above `filter` length
+//  argv[2]: encodable_threshold (int)
+//  argv[3]: non_encodable_thres (int)
+//  argv[4]: output file
+//  argv[5]: output format: `jsonl`, `libsvm` or `binary` (@see `writer`),
+//           or `wvc`, a memory-mappable container (@see `Container`)
+//  argv[6]: (optional) sparse (true, default) or dense (false) vectors
+//  argv[7]: (optional) encoding threads, all cores if omitted or zero
+//  RETURN: {encodable, non_encodable, count} - vectors are written straight to
+//          the file, a chunk at a time, and never packed into v8 arrays
+void compress_to_file(const v8::FunctionCallbackInfo<v8::Value>& args)
+{
+    if (args.Length() > 5 && args.Length() < 9)
+    {
+        Isolate* isolate = args.GetIsolate();
+        // unpack node data
+        corpus reviews = unpack_corpus(isolate, args);
+        corpus::view selected = reviews.all();
+        // get params
+        unsigned int f = args[1]->Uint32Value();
+        unsigned int x = args[2]->Uint32Value();
+        unsigned int y = args[3]->Uint32Value();
+        v8::String::Utf8Value filename(args[4]);
+        v8::String::Utf8Value format(args[5]);
+        bool sparse = args.Length() > 6 ? args[6]->BooleanValue() : true;
+        unsigned int threads = args.Length() > 7 ? args[7]->Uint32Value() : 0;
+        // tag, filter, semantics and principals
+        pipeline blob(reviews, selected, f, x, y, threads, unpack_budget(isolate, args[0]),
+                      unpack_depth(isolate, args[0]));
+        column_layout columns = unpack_columns(isolate, args[0], blob.max_size, reviews, selected);
+        dtype values = unpack_dtype(isolate, args[0]);
+
+        // encode, write and release a chunk at a time
+        bool container = std::string(*format) == "wvc";
+        bool csr = container && unpack_csr(isolate, args[0]);
+        std::unique_ptr<writer> text_out;
+        std::unique_ptr<container_writer> container_out;
+        if (container)
+            container_out.reset(new container_writer(*filename, blob.algo.encodable(),
+                                                     blob.algo.non_encodable(), columns.columns,
+                                                     std::uint64_t(blob.algo.encodable().size()
+                                                                   + blob.algo.non_encodable().size())
+                                                     * columns.columns,
+                                                     csr, values));
+        else
+            text_out.reset(new writer(*filename, output_of(*format), 1 << 20, values));
+
+        for (std::size_t begin = 0; begin < selected.size(); begin += dense_chunk)
+        {
+            std::size_t end = std::min<std::size_t>(selected.size(), begin + dense_chunk);
+            corpus::view chunk;
+            chunk.indices.assign(selected.indices.begin() + begin, selected.indices.begin() + end);
+            blob.algo.compressed_data(reviews, chunk, columns, sparse, threads);
+            if (container)
+                container_out->write(reviews, chunk);
+            else
+                text_out->write(reviews, chunk);
+            for (std::uint32_t i : chunk.indices)
+                thrust::host_vector<float>().swap(reviews.vectors[i]);
+        }
+        if (container)
+            container_out->close();
+        else
+            text_out->flush();
+
+        Local<Object> result = Object::New(isolate);
+        pack_principals(isolate, blob.algo, result);
+        result->Set(String::NewFromUtf8(isolate, "count"), Number::New(isolate, selected.size()));
+        args.GetReturnValue().Set(result);
+    }
+    else
+        throw std::runtime_error("illegal params");
+}
+
+//  persistent handle of a fitted encoder, for one review at a time:
+//  the encoder, the tagger and the interned vocabulary stay warm between calls
+//
+//  new Encoder(filename): load an encoder saved by `fit`
+//  encoder.encode(text[, sparse = true[, dtype = 'float32']]): {indices: Uint32Array, values, length}
+//      the non-zero entries (ascending indices) of the review's `length` wide vector,
+//      `values` a Float32Array, Uint16Array (`float16` bits) or Uint8Array (`uint8`, 1/255 steps)
+//  encoder.latency([reset = false]): {count, p50, p90, p99, max} of `encode` calls, in microseconds
+class encoder_handle : public node::ObjectWrap
+{
+public:
+
+    static void init(Handle<Object> exports)
+    {
+        Isolate* isolate = Isolate::GetCurrent();
+        Local<FunctionTemplate> tpl = FunctionTemplate::New(isolate, create);
+        tpl->SetClassName(String::NewFromUtf8(isolate, "Encoder"));
+        tpl->InstanceTemplate()->SetInternalFieldCount(1);
+        NODE_SET_PROTOTYPE_METHOD(tpl, "encode", encode);
+        NODE_SET_PROTOTYPE_METHOD(tpl, "latency", latency);
+        constructor.Reset(isolate, tpl->GetFunction());
+        exports->Set(String::NewFromUtf8(isolate, "Encoder"), tpl->GetFunction());
+    }
+
+private:
+
+    explicit encoder_handle(const std::string & filename)
+    : fitted(encoder::load(filename))
+    {}
+
+    static void create(const v8::FunctionCallbackInfo<v8::Value>& args)
+    {
+        Isolate* isolate = args.GetIsolate();
+        if (args.Length() != 1)
+            return fail(isolate, "illegal params");
+
+        // `Encoder(filename)` without `new` is a construct call too
+        if (!args.IsConstructCall())
+        {
+            Local<Value> argv[1] = {args[0]};
+            Local<Function> ctor = Local<Function>::New(isolate, constructor);
+            // empty if the construct call threw: its exception is pending
+            MaybeLocal<Object> instance = ctor->NewInstance(isolate->GetCurrentContext(), 1, argv);
+            if (!instance.IsEmpty())
+                args.GetReturnValue().Set(instance.ToLocalChecked());
+            return;
+        }
+        v8::String::Utf8Value filename(args[0]);
+        encoder_handle * handle = nullptr;
+        try
+        {
+            handle = new encoder_handle(*filename);
+        }
+        catch (const std::exception & error)
+        {
+            return fail(isolate, error.what());
+        }
+        handle->Wrap(args.This());
+        args.GetReturnValue().Set(args.This());
+    }
+
+    static void encode(const v8::FunctionCallbackInfo<v8::Value>& args)
+    {
+        auto start = std::chrono::steady_clock::now();
+        Isolate* isolate = args.GetIsolate();
+        encoder_handle * handle = ObjectWrap::Unwrap<encoder_handle>(args.Holder());
+        if (args.Length() < 1 || args.Length() > 3)
+            return fail(isolate, "illegal params");
+
+        v8::String::Utf8Value text(args[0]);
+        bool sparse = args.Length() > 1 ? args[1]->BooleanValue() : true;
+        dtype values = dtype::float32;
+        try
+        {
+            if (args.Length() > 2)
+            {
+                v8::String::Utf8Value name(args[2]);
+                values = dtype_of(*name);
+            }
+
+            // tag, then look up the fitted rows - the tagger can't tag an empty review.
+            // Tokens are looked up, not interned: unknown ones are misses
+            std::vector<word> words;
+            if (text.length() > 0)
+                for (const std::pair<std::string,penn> & item : handle->tkr.tagger.tag(*text))
+                    words.push_back(word(symbols::singleton().find(item.first),
+                                         static_cast<std::uint8_t>(item.second)));
+            handle->fitted.transform(words, sparse, handle->indices, handle->values);
+        }
+        catch (const std::exception & error)
+        {
+            return fail(isolate, error.what());
+        }
+
+        Local<Object> result = Object::New(isolate);
+        result->Set(String::NewFromUtf8(isolate, "indices"),
+                    pack_typed<Uint32Array>(isolate, handle->indices));
+        result->Set(String::NewFromUtf8(isolate, "values"),
+                    pack_narrowed(isolate, handle->values, values));
+        result->Set(String::NewFromUtf8(isolate, "length"),
+                    Number::New(isolate, handle->fitted.width()));
+        args.GetReturnValue().Set(result);
+
+        auto elapsed = std::chrono::steady_clock::now() - start;
+        handle->timings.record(std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count());
+    }
+
+    static void latency(const v8::FunctionCallbackInfo<v8::Value>& args)
+    {
+        Isolate* isolate = args.GetIsolate();
+        encoder_handle * handle = ObjectWrap::Unwrap<encoder_handle>(args.Holder());
+        const histogram & timings = handle->timings;
+
+        Local<Object> result = Object::New(isolate);
+        result->Set(String::NewFromUtf8(isolate, "count"), Number::New(isolate, timings.count));
+        result->Set(String::NewFromUtf8(isolate, "p50"), Number::New(isolate, timings.percentile(0.5)));
+        result->Set(String::NewFromUtf8(isolate, "p90"), Number::New(isolate, timings.percentile(0.9)));
+        result->Set(String::NewFromUtf8(isolate, "p99"), Number::New(isolate, timings.percentile(0.99)));
+        result->Set(String::NewFromUtf8(isolate, "max"), Number::New(isolate, timings.largest));
+        args.GetReturnValue().Set(result);
+
+        if (args.Length() > 0 && args[0]->BooleanValue())
+            handle->timings.reset();
+    }
+
+    // raise a js Error: a C++ exception must not unwind through v8 frames,
+    // it would terminate the process this handle lives in
+    static void fail(Isolate * isolate, const char * message)
+    {
+        isolate->ThrowException(Exception::Error(String::NewFromUtf8(isolate, message)));
+    }
+
+    static Persistent<Function> constructor;
+    // fitted principals and rows
+    encoder fitted;
+    // POS tagger (singleton) reference
+    tokenizer tkr;
+    // per-call latency, in microseconds
+    histogram timings;
+    // non-zero entries of the last review - reused to avoid allocations
+    std::vector<std::uint32_t> indices;
+    std::vector<float> values;
+};
+
+Persistent<Function> encoder_handle::constructor;
+
+//  handle of a memory mapped `wvc` container (@see `mapped_container`): sections
+//  are viewed in place, as typed arrays over the mapping, and never copied
+//
+//  new Container(filename): map a container written by `compress_to_file(..., 'wvc')`,
+//      with its header {rows, width, columns, encodable, non_encodable, dtype, csr, nnz}
+//      and `vocabulary`, [{token, tag}] by column
+//  container.section(name, begin, end): elements `begin` to `end` (exclusive) of section
+//      `scores` (Float32Array), `values` (as `Encoder.encode`'s), `indices` (Uint32Array)
+//      or `indptr` (Uint32Array, low and high word of each uint64). The file stays
+//      mapped while the container or any of its views is reachable
+class container_handle : public node::ObjectWrap
+{
+public:
+
+    static void init(Handle<Object> exports)
+    {
+        Isolate* isolate = Isolate::GetCurrent();
+        Local<FunctionTemplate> tpl = FunctionTemplate::New(isolate, create);
+        tpl->SetClassName(String::NewFromUtf8(isolate, "Container"));
+        tpl->InstanceTemplate()->SetInternalFieldCount(1);
+        NODE_SET_PROTOTYPE_METHOD(tpl, "section", section);
+        constructor.Reset(isolate, tpl->GetFunction());
+        exports->Set(String::NewFromUtf8(isolate, "Container"), tpl->GetFunction());
+    }
+
+private:
+
+    explicit container_handle(const std::string & filename)
+    : mapping(std::make_shared<mapped_container>(filename))
+    {}
+
+    static void create(const v8::FunctionCallbackInfo<v8::Value>& args)
+    {
+        Isolate* isolate = args.GetIsolate();
+        if (args.Length() != 1)
+            return fail(isolate, "illegal params");
+
+        // `Container(filename)` without `new` is a construct call too
+        if (!args.IsConstructCall())
+        {
+            Local<Value> argv[1] = {args[0]};
+            Local<Function> ctor = Local<Function>::New(isolate, constructor);
+            // empty if the construct call threw: its exception is pending
+            MaybeLocal<Object> instance = ctor->NewInstance(isolate->GetCurrentContext(), 1, argv);
+            if (!instance.IsEmpty())
+                args.GetReturnValue().Set(instance.ToLocalChecked());
+            return;
+        }
+        v8::String::Utf8Value filename(args[0]);
+        container_handle * handle = nullptr;
+        std::vector<std::pair<std::string, std::string>> keys;
+        try
+        {
+            handle = new container_handle(*filename);
+            keys = handle->mapping->vocabulary();
+        }
+        catch (const std::exception & error)
+        {
+            delete handle;
+            return fail(isolate, error.what());
+        }
+        handle->Wrap(args.This());
+
+        const container_header & header = handle->mapping->header();
+        Local<Object> self = args.This();
+        self->Set(String::NewFromUtf8(isolate, "rows"), Number::New(isolate, header.rows));
+        self->Set(String::NewFromUtf8(isolate, "width"), Number::New(isolate, header.width));
+        self->Set(String::NewFromUtf8(isolate, "columns"), Number::New(isolate, header.columns));
+        self->Set(String::NewFromUtf8(isolate, "encodable"), Number::New(isolate, header.encodable));
+        self->Set(String::NewFromUtf8(isolate, "non_encodable"), Number::New(isolate, header.non_encodable));
+        self->Set(String::NewFromUtf8(isolate, "dtype"),
+                  String::NewFromUtf8(isolate, dtype_name(handle->mapping->values_type())));
+        self->Set(String::NewFromUtf8(isolate, "csr"), Boolean::New(isolate, header.csr != 0));
+        self->Set(String::NewFromUtf8(isolate, "nnz"), Number::New(isolate, header.nnz));
+
+        Local<Array> vocabulary = Array::New(isolate);
+        for (unsigned int i = 0; i < keys.size(); i++)
+        {
+            Local<Object> obj = Object::New(isolate);
+            obj->Set(String::NewFromUtf8(isolate, "token"), String::NewFromUtf8(isolate, keys[i].first.c_str()));
+            obj->Set(String::NewFromUtf8(isolate, "tag"), String::NewFromUtf8(isolate, keys[i].second.c_str()));
+            vocabulary->Set(i, obj);
+        }
+        self->Set(String::NewFromUtf8(isolate, "vocabulary"), vocabulary);
+        args.GetReturnValue().Set(self);
+    }
+
+    static void section(const v8::FunctionCallbackInfo<v8::Value>& args)
+    {
+        Isolate* isolate = args.GetIsolate();
+        container_handle * handle = ObjectWrap::Unwrap<container_handle>(args.Holder());
+        if (args.Length() != 3 || !args[1]->IsNumber() || !args[2]->IsNumber())
+            return fail(isolate, "illegal params");
+
+        const mapped_container & mapped = *handle->mapping;
+        const container_header & header = mapped.header();
+        v8::String::Utf8Value name(args[0]);
+        std::string which(*name);
+        double begin = args[1]->NumberValue(), end = args[2]->NumberValue();
+
+        // elements, their size and the first of them - indptr elements are uint64 word pairs
+        std::uint64_t count;
+        std::size_t size;
+        const char * first;
+        if (which == "scores")
+            count = header.rows, size = sizeof(float), first = reinterpret_cast<const char*>(mapped.scores());
+        else if (which == "values")
+            count = header.nnz, size = size_of(mapped.values_type()), first = static_cast<const char*>(mapped.values());
+        else if (which == "indices" && header.csr)
+            count = header.nnz, size = sizeof(std::uint32_t), first = reinterpret_cast<const char*>(mapped.indices());
+        else if (which == "indptr" && header.csr)
+            count = 2 * (header.rows + 1), size = sizeof(std::uint32_t), first = reinterpret_cast<const char*>(mapped.indptr());
+        else
+            return fail(isolate, ("no container section `"+which+"`").c_str());
+        if (!(begin >= 0 && begin <= end && end <= double(count)) || begin != std::uint64_t(begin) || end != std::uint64_t(end))
+            return fail(isolate, "section range out of bounds");
+
+        std::size_t length = std::size_t(end) - std::size_t(begin);
+        Local<ArrayBuffer> buffer = view(isolate, handle->mapping, first + std::size_t(begin) * size, length * size);
+        if (which == "values")
+        {
+            switch (mapped.values_type())
+            {
+                case dtype::float16: return args.GetReturnValue().Set(Uint16Array::New(buffer, 0, length));
+                case dtype::uint8:   return args.GetReturnValue().Set(Uint8Array::New(buffer, 0, length));
+                default:             return args.GetReturnValue().Set(Float32Array::New(buffer, 0, length));
+            }
+        }
+        if (which == "scores")
+            return args.GetReturnValue().Set(Float32Array::New(buffer, 0, length));
+        args.GetReturnValue().Set(Uint32Array::New(buffer, 0, length));
+    }
+
+    // a reference to the mapping held by one view, dropped when v8 collects the view
+    struct mapped_view
+    {
+        std::shared_ptr<mapped_container> mapping;
+        Persistent<ArrayBuffer> buffer;
+    };
+
+    // an external (not v8 owned) ArrayBuffer of @param bytes bytes at @param data,
+    // inside @param mapping - which it keeps mapped
+    static Local<ArrayBuffer> view(
+                                    Isolate * isolate,
+                                    const std::shared_ptr<mapped_container> & mapping,
+                                    const char * data,
+                                    std::size_t bytes
+                                  )
+    {
+        Local<ArrayBuffer> buffer = ArrayBuffer::New(isolate, const_cast<char*>(data), bytes);
+        mapped_view * held = new mapped_view;
+        held->mapping = mapping;
+        held->buffer.Reset(isolate, buffer);
+        held->buffer.SetWeak(held, release, v8::WeakCallbackType::kParameter);
+        return buffer;
+    }
+
+    static void release(const v8::WeakCallbackInfo<mapped_view> & info)
+    {
+        mapped_view * held = info.GetParameter();
+        held->buffer.Reset();
+        delete held;
+    }
+
+    // raise a js Error, @see `encoder_handle::fail`
+    static void fail(Isolate * isolate, const char * message)
+    {
+        isolate->ThrowException(Exception::Error(String::NewFromUtf8(isolate, message)));
+    }
+
+    static Persistent<Function> constructor;
+    // the mapped file, shared with the views over it
+    std::shared_ptr<mapped_container> mapping;
+};
+
+Persistent<Function> container_handle::constructor;
+
 void init(Handle <Object> exports, Handle<Object> module)
 {
     NODE_SET_METHOD(exports, "compress_sparse", compress_sparse);
     NODE_SET_METHOD(exports, "compress_dense", compress_dense);
+    NODE_SET_METHOD(exports, "compress_table", compress_table);
+    NODE_SET_METHOD(exports, "compress_pooled", compress_pooled);
+    NODE_SET_METHOD(exports, "compress_to_file", compress_to_file);
+    NODE_SET_METHOD(exports, "fit", fit);
+    NODE_SET_METHOD(exports, "transform", transform);
+    encoder_handle::init(exports);
+    container_handle::init(exports);
 }
 
 NODE_MODULE(word_vec, init)